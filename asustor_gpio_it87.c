@@ -12,13 +12,16 @@
 
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
+#include <linux/bitmap.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/io.h>
 #include <linux/errno.h>
 #include <linux/ioport.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/gpio/driver.h>
 #include <linux/version.h> // for LINUX_VERSION_CODE and KERNEL_VERSION()
 
@@ -50,7 +53,11 @@
 /**
  * struct it87_gpio - it87-specific GPIO chip
  * @chip: the underlying gpio_chip structure
- * @lock: a lock to avoid races between operations
+ * @config_lock: serialises Super I/O config mode accesses and the
+ *	shadow state below; sleepable, as request_muxed_region() may sleep,
+ *	so .request, .free and .direction_* are process context only
+ * @lock: protects the read-modify-write of the GPIO data ports, which
+ *	may happen from atomic context (e.g. LED triggers)
  * @io_base: base address for gpio ports
  * @io_size: size of the port rage starting from io_base.
  * @output_base: Super I/O register address for Output Enable register
@@ -59,18 +66,26 @@
  *	required because IT87xx chips might only provide Simple I/O
  *	switches on a subset of lines, whereas the others keep the
  *	same status all time.
+ * @output: shadow copy of the Output Enable registers, so direction
+ *	changes need no read and .get_direction no I/O at all
+ * @configured: lines set up by asustor_gpio_it87_configure(); these
+ *	keep their Simple I/O and direction setup when requested
  */
 struct it87_gpio {
 	struct gpio_chip chip;
+	struct mutex config_lock;
 	spinlock_t lock;
 	u16 io_base;
 	u16 io_size;
 	u8 output_base;
 	u8 simple_base;
 	u8 simple_size;
+	u8 output[8];
+	DECLARE_BITMAP(configured, 64);
 };
 
 static struct it87_gpio it87_gpio_chip = {
+	.config_lock = __MUTEX_INITIALIZER(it87_gpio_chip.config_lock),
 	.lock = __SPIN_LOCK_UNLOCKED(it87_gpio_chip.lock),
 };
 
@@ -151,10 +166,16 @@ static int it87_gpio_request(struct gpio_chip *chip, unsigned gpio_num)
 	int rc = 0;
 	struct it87_gpio *it87_gpio = gpiochip_get_data(chip);
 
+	might_sleep();
+
 	mask = 1 << (gpio_num % 8);
 	group = (gpio_num / 8);
 
-	spin_lock(&it87_gpio->lock);
+	mutex_lock(&it87_gpio->config_lock);
+
+	/* already switched to Simple I/O with its direction set */
+	if (test_bit(gpio_num, it87_gpio->configured))
+		goto exit;
 
 	rc = superio_enter();
 	if (rc)
@@ -169,15 +190,31 @@ static int it87_gpio_request(struct gpio_chip *chip, unsigned gpio_num)
 	/* clear output enable, setting the pin to input, as all the
 	 * newly-exported GPIO interfaces are set to input.
 	 */
-	superio_clear_mask(mask, group + it87_gpio->output_base);
+	if (it87_gpio->output[group] & mask) {
+		it87_gpio->output[group] &= ~mask;
+		superio_outb(it87_gpio->output[group],
+			     group + it87_gpio->output_base);
+	}
 
 	superio_exit();
 
 exit:
-	spin_unlock(&it87_gpio->lock);
+	mutex_unlock(&it87_gpio->config_lock);
 	return rc;
 }
 
+static void it87_gpio_free(struct gpio_chip *chip, unsigned gpio_num)
+{
+	struct it87_gpio *it87_gpio = gpiochip_get_data(chip);
+
+	might_sleep();
+
+	/* the next request starts out as an input again */
+	mutex_lock(&it87_gpio->config_lock);
+	clear_bit(gpio_num, it87_gpio->configured);
+	mutex_unlock(&it87_gpio->config_lock);
+}
+
 static int it87_gpio_get(struct gpio_chip *chip, unsigned gpio_num)
 {
 	u16 reg;
@@ -190,28 +227,57 @@ static int it87_gpio_get(struct gpio_chip *chip, unsigned gpio_num)
 	return !!(inb(reg) & mask);
 }
 
-static int it87_gpio_direction_in(struct gpio_chip *chip, unsigned gpio_num)
+static int it87_gpio_get_direction(struct gpio_chip *chip, unsigned gpio_num)
 {
-	u8 mask, group;
-	int rc = 0;
 	struct it87_gpio *it87_gpio = gpiochip_get_data(chip);
 
+	if (it87_gpio->output[gpio_num / 8] & (1 << (gpio_num % 8)))
+		return GPIO_LINE_DIRECTION_OUT;
+
+	return GPIO_LINE_DIRECTION_IN;
+}
+
+/* Update the Output Enable shadow and write it out if it changed */
+static int it87_gpio_set_output(struct it87_gpio *it87_gpio,
+				unsigned gpio_num, bool output)
+{
+	u8 mask, group, val;
+	int rc;
+
 	mask = 1 << (gpio_num % 8);
 	group = (gpio_num / 8);
 
-	spin_lock(&it87_gpio->lock);
+	val = it87_gpio->output[group];
+	if (output)
+		val |= mask;
+	else
+		val &= ~mask;
+	if (val == it87_gpio->output[group])
+		return 0;
 
 	rc = superio_enter();
 	if (rc)
-		goto exit;
+		return rc;
 
-	/* clear the output enable bit */
-	superio_clear_mask(mask, group + it87_gpio->output_base);
+	superio_outb(val, group + it87_gpio->output_base);
+	it87_gpio->output[group] = val;
 
 	superio_exit();
+	return 0;
+}
 
-exit:
-	spin_unlock(&it87_gpio->lock);
+static int it87_gpio_direction_in(struct gpio_chip *chip, unsigned gpio_num)
+{
+	int rc;
+	struct it87_gpio *it87_gpio = gpiochip_get_data(chip);
+
+	might_sleep();
+	mutex_lock(&it87_gpio->config_lock);
+
+	/* clear the output enable bit */
+	rc = it87_gpio_set_output(it87_gpio, gpio_num, false);
+
+	mutex_unlock(&it87_gpio->config_lock);
 	return rc;
 }
 
@@ -226,47 +292,156 @@ static void it87_gpio_set(struct gpio_chip *chip,
 {
 	u8 mask, curr_vals;
 	u16 reg;
+	unsigned long flags;
 	struct it87_gpio *it87_gpio = gpiochip_get_data(chip);
 
 	mask = 1 << (gpio_num % 8);
 	reg = (gpio_num / 8) + it87_gpio->io_base;
 
+	spin_lock_irqsave(&it87_gpio->lock, flags);
 	curr_vals = inb(reg);
 	if (val)
 		outb(curr_vals | mask, reg);
 	else
 		outb(curr_vals & ~mask, reg);
+	spin_unlock_irqrestore(&it87_gpio->lock, flags);
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 17, 0)
 	return 0;
 #endif
 }
 
-static int it87_gpio_direction_out(struct gpio_chip *chip,
-				   unsigned gpio_num, int val)
+/* One port read or write per 8 lines, see it87_gpio_set_multiple() */
+static int it87_gpio_get_multiple(struct gpio_chip *chip, unsigned long *mask,
+				  unsigned long *bits)
 {
-	u8 mask, group;
-	int rc = 0;
 	struct it87_gpio *it87_gpio = gpiochip_get_data(chip);
+	unsigned long offset, port_mask;
+	u8 val;
 
-	mask = 1 << (gpio_num % 8);
-	group = (gpio_num / 8);
+	for_each_set_clump8(offset, port_mask, mask, chip->ngpio) {
+		val = bitmap_get_value8(bits, offset) & ~port_mask;
+		val |= inb(offset / 8 + it87_gpio->io_base) & port_mask;
+		bitmap_set_value8(bits, val, offset);
+	}
+
+	return 0;
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 17, 0)
+static int it87_gpio_set_multiple(struct gpio_chip *chip, unsigned long *mask,
+				  unsigned long *bits)
+#else
+static void it87_gpio_set_multiple(struct gpio_chip *chip, unsigned long *mask,
+				   unsigned long *bits)
+#endif
+{
+	struct it87_gpio *it87_gpio = gpiochip_get_data(chip);
+	unsigned long offset, port_mask, flags;
+	u16 reg;
+	u8 val;
+
+	spin_lock_irqsave(&it87_gpio->lock, flags);
+	for_each_set_clump8(offset, port_mask, mask, chip->ngpio) {
+		reg = offset / 8 + it87_gpio->io_base;
+		val = inb(reg) & ~port_mask;
+		val |= bitmap_get_value8(bits, offset) & port_mask;
+		outb(val, reg);
+	}
+	spin_unlock_irqrestore(&it87_gpio->lock, flags);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 17, 0)
+	return 0;
+#endif
+}
 
-	spin_lock(&it87_gpio->lock);
+/**
+ * asustor_gpio_it87_configure - set up many lines in one config mode session
+ * @mask: lines to configure
+ * @output: lines in @mask to make outputs, the others become inputs
+ * @values: raw levels of the @output lines
+ *
+ * Switches every line in @mask to Simple I/O and sets its direction while
+ * entering Super I/O config mode only once. The outputs are latched to
+ * @values before they are enabled, so they don't glitch. The lines keep this
+ * setup when they are requested afterwards, so e.g. leds-gpio needs no
+ * further config mode accesses. All bitmaps must cover the 64 possible lines.
+ */
+int asustor_gpio_it87_configure(const unsigned long *mask,
+				const unsigned long *output,
+				const unsigned long *values)
+{
+	struct it87_gpio *it87_gpio = &it87_gpio_chip;
+	unsigned int group, ngroups = it87_gpio->chip.ngpio / 8;
+	unsigned long flags;
+	u8 lines, val;
+	u16 reg;
+	int rc;
+
+	mutex_lock(&it87_gpio->config_lock);
+
+	/* latch the values first, like it87_gpio_direction_out() */
+	spin_lock_irqsave(&it87_gpio->lock, flags);
+	for (group = 0; group < ngroups; group++) {
+		lines = bitmap_get_value8(mask, group * 8) &
+			bitmap_get_value8(output, group * 8);
+		if (!lines)
+			continue;
+
+		reg = group + it87_gpio->io_base;
+		val = inb(reg) & ~lines;
+		outb(val | (bitmap_get_value8(values, group * 8) & lines), reg);
+	}
+	spin_unlock_irqrestore(&it87_gpio->lock, flags);
 
 	rc = superio_enter();
 	if (rc)
 		goto exit;
 
-	/* set the output enable bit */
-	superio_set_mask(mask, group + it87_gpio->output_base);
-
-	it87_gpio_set(chip, gpio_num, val);
+	for (group = 0; group < ngroups; group++) {
+		lines = bitmap_get_value8(mask, group * 8);
+		if (!lines)
+			continue;
+
+		if (group < it87_gpio->simple_size)
+			superio_set_mask(lines,
+					 group + it87_gpio->simple_base);
+
+		val = it87_gpio->output[group] & ~lines;
+		val |= bitmap_get_value8(output, group * 8) & lines;
+		if (val != it87_gpio->output[group]) {
+			superio_outb(val, group + it87_gpio->output_base);
+			it87_gpio->output[group] = val;
+		}
+	}
 
 	superio_exit();
 
+	bitmap_or(it87_gpio->configured, it87_gpio->configured, mask,
+		  it87_gpio->chip.ngpio);
+
 exit:
-	spin_unlock(&it87_gpio->lock);
+	mutex_unlock(&it87_gpio->config_lock);
+	return rc;
+}
+EXPORT_SYMBOL_GPL(asustor_gpio_it87_configure);
+
+static int it87_gpio_direction_out(struct gpio_chip *chip,
+				   unsigned gpio_num, int val)
+{
+	int rc;
+	struct it87_gpio *it87_gpio = gpiochip_get_data(chip);
+
+	might_sleep();
+	mutex_lock(&it87_gpio->config_lock);
+
+	/* latch the value first so the line doesn't glitch when enabled */
+	it87_gpio_set(chip, gpio_num, val);
+
+	/* set the output enable bit */
+	rc = it87_gpio_set_output(it87_gpio, gpio_num, true);
+
+	mutex_unlock(&it87_gpio->config_lock);
 	return rc;
 }
 
@@ -274,10 +449,21 @@ static const struct gpio_chip it87_template_chip = {
 	.label			= KBUILD_MODNAME,
 	.owner			= THIS_MODULE,
 	.request		= it87_gpio_request,
+	.free			= it87_gpio_free,
+	.get_direction		= it87_gpio_get_direction,
 	.get			= it87_gpio_get,
+	.get_multiple		= it87_gpio_get_multiple,
 	.direction_input	= it87_gpio_direction_in,
 	.set			= it87_gpio_set,
+	.set_multiple		= it87_gpio_set_multiple,
 	.direction_output	= it87_gpio_direction_out,
+	/*
+	 * .get and .set only touch the spinlocked data ports and never sleep.
+	 * .request, .free and .direction_* enter config mode and may sleep;
+	 * gpiolib calls them from process context only, which might_sleep()
+	 * checks.
+	 */
+	.can_sleep		= false,
 	.base			= -1
 };
 
@@ -355,6 +541,10 @@ static int __init it87_gpio_init(void)
 	/* fetch GPIO base address */
 	it87_gpio->io_base = superio_inw(gpio_ba_reg);
 
+	/* Output Enable is only changed through this driver from now on */
+	for (i = 0; i < it87_gpio->chip.ngpio / 8; i++)
+		it87_gpio->output[i] = superio_inb(it87_gpio->output_base + i);
+
 	superio_exit();
 
 	pr_info("Found Chip IT%04x rev %x. %u GPIO lines starting at %04xh\n",
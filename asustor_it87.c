@@ -56,10 +56,12 @@
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
 #include <linux/bitops.h>
+#include <linux/debugfs.h>
 #include <linux/module.h>
 #include <linux/init.h>
 #include <linux/slab.h>
 #include <linux/jiffies.h>
+#include <linux/ktime.h>
 #include <linux/platform_device.h>
 #include <linux/hwmon.h>
 #include <linux/hwmon-sysfs.h>
@@ -71,6 +73,11 @@
 #include <linux/dmi.h>
 #include <linux/acpi.h>
 #include <linux/io.h>
+#include <linux/sort.h>
+#include <linux/seqlock.h>
+#include <linux/thermal.h>
+#include <linux/workqueue.h>
+#include <linux/version.h>
 
 #ifndef IT87_DRIVER_VERSION
 #define IT87_DRIVER_VERSION "<not provided>"
@@ -92,9 +99,40 @@ static bool ignore_resource_conflict;
 module_param(ignore_resource_conflict, bool, 0000);
 MODULE_PARM_DESC(ignore_resource_conflict, "Ignore ACPI resource conflict");
 
-static bool mmio;
+static bool mmio = true;
 module_param(mmio, bool, 0000);
-MODULE_PARM_DESC(mmio, "Use MMIO if available");
+MODULE_PARM_DESC(mmio, "Use MMIO if available (default true)");
+
+static unsigned int config_interval = 10000;
+module_param(config_interval, uint, 0644);
+MODULE_PARM_DESC(config_interval,
+		 "Cache lifetime of limit and fan control registers in ms (default 10000)");
+
+static unsigned int sample_interval;
+module_param(sample_interval, uint, 0444);
+MODULE_PARM_DESC(sample_interval,
+		 "Refresh measured values in the background every N ms, 0 to disable (default 0)");
+
+static unsigned int fan_loop_interval = 2000;
+module_param(fan_loop_interval, uint, 0644);
+MODULE_PARM_DESC(fan_loop_interval,
+		 "Period of the fan control loop (pwmN_enable=3) in ms, at least 100 (default 2000)");
+
+static unsigned int fan_loop_kp = 8;
+module_param(fan_loop_kp, uint, 0644);
+MODULE_PARM_DESC(fan_loop_kp,
+		 "Fan control loop proportional gain, PWM steps per degree C (default 8)");
+
+static unsigned int fan_loop_ki = 1;
+module_param(fan_loop_ki, uint, 0644);
+MODULE_PARM_DESC(fan_loop_ki,
+		 "Fan control loop integral gain, PWM steps per degree C and second (default 1)");
+
+/* pwm3 drives the front panel LED brightness on ASUSTOR devices */
+static unsigned int cooling_mask = 0x3b;
+module_param(cooling_mask, uint, 0444);
+MODULE_PARM_DESC(cooling_mask,
+		 "PWM outputs with a fan to register as thermal cooling devices, bit 0 = pwm1 (default 0x3b)");
 
 static struct platform_device *it87_pdev[2];
 
@@ -224,6 +262,16 @@ static inline void superio_exit(int ioreg, bool doexit)
 /* Update battery voltage after every reading if true */
 static bool update_vbat;
 
+/* Default cache lifetime of measured values, in milliseconds */
+#define IT87_UPDATE_INTERVAL	1500
+
+/* Default settings of the fan control loop */
+#define IT87_FAN_LOOP_TARGET	45000	/* millidegree C */
+#define IT87_FAN_LOOP_MIN	64
+#define IT87_FAN_LOOP_MAX	255
+#define IT87_FAN_LOOP_STEP	16
+#define IT87_FAN_LOOP_MIN_MS	100	/* Shortest fan_loop_interval */
+
 /* Many IT87 constants specified below */
 
 /* Length of ISA address segment */
@@ -337,6 +385,37 @@ static const u16 IT87_REG_TEMP_SRC1[] =  { 0x21d, 0x21e, 0x21f };
 #define NUM_PWM			ARRAY_SIZE(IT87_REG_PWM)
 #define NUM_AUTO_PWM		ARRAY_SIZE(IT87_REG_PWM)
 
+/*
+ * Upper bound for the number of registers read by it87_update_device():
+ * 3 per voltage, 4 per fan and temperature, up to 10 per pwm channel,
+ * plus fan divisor, alarms, beep, fan control, sensor and VID registers.
+ */
+#define IT87_SNAP_MAX_OPS	(NUM_VIN * 3 + NUM_FAN * 4 + NUM_TEMP * 4 + \
+				 NUM_PWM * 10 + 10)
+
+/*
+ * The register cache is split into slices which are refreshed
+ * independently: one per channel, plus alarms/beeps and the global
+ * fan control, divisor and sensor type registers.
+ */
+#define IT87_SLICE_IN(nr)	(nr)
+#define IT87_SLICE_FAN(nr)	(NUM_VIN + (nr))
+#define IT87_SLICE_TEMP(nr)	(NUM_VIN + NUM_FAN + (nr))
+#define IT87_SLICE_PWM(nr)	(NUM_VIN + NUM_FAN + NUM_TEMP + (nr))
+#define IT87_SLICE_ALARM	(NUM_VIN + NUM_FAN + NUM_TEMP + NUM_PWM)
+#define IT87_SLICE_CTRL		(IT87_SLICE_ALARM + 1)
+#define IT87_SLICES		(IT87_SLICE_CTRL + 1)
+#define IT87_ALL_SLICES		GENMASK_ULL(IT87_SLICES - 1, 0)
+
+/*
+ * Each slice has two cache groups with separate lifetimes: measured
+ * values change all the time (update_interval), limits and fan control
+ * settings only when written (config_interval).
+ */
+#define IT87_SNAP_INPUT(slice)	((slice) * 2)
+#define IT87_SNAP_CONFIG(slice)	((slice) * 2 + 1)
+#define IT87_SNAP_GROUPS	(IT87_SLICES * 2)
+
 
 struct it87_devices {
 	const char *name;
@@ -382,6 +461,7 @@ struct it87_devices {
 
 #define FEAT_BLINK_CTRL		BIT(28) /* control blinking of two GPIO LEDs */
 #define FEAT_BLINK_CTRL_ADV	BIT(29) /* additionally supports more blinking modes and breathing of LED1 */
+#define FEAT_FAST_IO		BIT(30)	/* No I/O delay needed on port access */
 
 static const struct it87_devices it87_devices[] = {
 	[it87] = {
@@ -600,7 +680,8 @@ static const struct it87_devices it87_devices[] = {
 		.model = "IT8603E",
 		.features = FEAT_NEWER_AUTOPWM | FEAT_12MV_ADC | FEAT_16BIT_FANS
 			| FEAT_TEMP_PECI | FEAT_IN7_INTERNAL
-			| FEAT_AVCC3 | FEAT_PWM_FREQ2 | FEAT_SCALING,
+			| FEAT_AVCC3 | FEAT_PWM_FREQ2 | FEAT_SCALING
+			| FEAT_FAST_IO,
 		.num_temp_limit = 3,
 		.num_temp_offset = 3,
 		.num_temp_map = 4,
@@ -611,7 +692,8 @@ static const struct it87_devices it87_devices[] = {
 		.model = "IT8606E",
 		.features = FEAT_NEWER_AUTOPWM | FEAT_12MV_ADC | FEAT_16BIT_FANS
 			| FEAT_TEMP_PECI | FEAT_IN7_INTERNAL
-			| FEAT_AVCC3 | FEAT_PWM_FREQ2 | FEAT_SCALING,
+			| FEAT_AVCC3 | FEAT_PWM_FREQ2 | FEAT_SCALING
+			| FEAT_FAST_IO,
 		.num_temp_limit = 3,
 		.num_temp_offset = 3,
 		.num_temp_map = 3,
@@ -623,7 +705,7 @@ static const struct it87_devices it87_devices[] = {
 		.features = FEAT_NEWER_AUTOPWM | FEAT_12MV_ADC | FEAT_16BIT_FANS
 			| FEAT_TEMP_PECI | FEAT_IN7_INTERNAL | FEAT_NEW_TEMPMAP
 			| FEAT_AVCC3 | FEAT_PWM_FREQ2 | FEAT_SCALING
-			| FEAT_FANCTL_ONOFF,
+			| FEAT_FANCTL_ONOFF | FEAT_FAST_IO,
 		.num_temp_limit = 3,
 		.num_temp_offset = 3,
 		.num_temp_map = 6,
@@ -635,7 +717,8 @@ static const struct it87_devices it87_devices[] = {
 		.features = FEAT_NEWER_AUTOPWM | FEAT_11MV_ADC | FEAT_16BIT_FANS
 			| FEAT_TEMP_PECI | FEAT_FIVE_FANS
 			| FEAT_FIVE_PWM | FEAT_IN7_INTERNAL | FEAT_PWM_FREQ2
-			| FEAT_AVCC3 | FEAT_SCALING | FEAT_NEW_TEMPMAP,
+			| FEAT_AVCC3 | FEAT_SCALING | FEAT_NEW_TEMPMAP
+			| FEAT_FAST_IO,
 		.num_temp_limit = 6,
 		.num_temp_offset = 6,
 		.num_temp_map = 6,
@@ -648,7 +731,7 @@ static const struct it87_devices it87_devices[] = {
 			| FEAT_TEMP_PECI | FEAT_SIX_FANS
 			| FEAT_IN7_INTERNAL | FEAT_SIX_PWM | FEAT_PWM_FREQ2
 			| FEAT_SIX_TEMP | FEAT_VIN3_5V | FEAT_SCALING
-			| FEAT_FANCTL_ONOFF,
+			| FEAT_FANCTL_ONOFF | FEAT_FAST_IO,
 		.num_temp_limit = 3,
 		.num_temp_offset = 3,
 		.num_temp_map = 3,
@@ -660,7 +743,8 @@ static const struct it87_devices it87_devices[] = {
 		.features = FEAT_NEWER_AUTOPWM | FEAT_12MV_ADC | FEAT_16BIT_FANS
 			| FEAT_TEMP_PECI | FEAT_FIVE_FANS | FEAT_FOUR_TEMP
 			| FEAT_FIVE_PWM | FEAT_IN7_INTERNAL | FEAT_PWM_FREQ2
-			| FEAT_AVCC3 | FEAT_VIN3_5V | FEAT_SCALING,
+			| FEAT_AVCC3 | FEAT_VIN3_5V | FEAT_SCALING
+			| FEAT_FAST_IO,
 		.num_temp_limit = 3,
 		.num_temp_offset = 3,
 		.num_temp_map = 4,
@@ -673,7 +757,8 @@ static const struct it87_devices it87_devices[] = {
 		.features = FEAT_NEWER_AUTOPWM | FEAT_16BIT_FANS
 			| FEAT_AVCC3 | FEAT_NEW_TEMPMAP
 			| FEAT_11MV_ADC | FEAT_IN7_INTERNAL | FEAT_SIX_FANS
-			| FEAT_SIX_PWM | FEAT_BANK_SEL | FEAT_SCALING | FEAT_BLINK_CTRL | FEAT_BLINK_CTRL_ADV,
+			| FEAT_SIX_PWM | FEAT_BANK_SEL | FEAT_SCALING | FEAT_BLINK_CTRL | FEAT_BLINK_CTRL_ADV
+			| FEAT_FAST_IO,
 		.num_temp_limit = 6,
 		.num_temp_offset = 6,
 		.num_temp_map = 6,
@@ -686,7 +771,7 @@ static const struct it87_devices it87_devices[] = {
 			| FEAT_TEMP_PECI | FEAT_SIX_FANS
 			| FEAT_IN7_INTERNAL | FEAT_SIX_PWM | FEAT_PWM_FREQ2
 			| FEAT_SIX_TEMP | FEAT_SCALING | FEAT_AVCC3
-			| FEAT_FANCTL_ONOFF,
+			| FEAT_FANCTL_ONOFF | FEAT_FAST_IO,
 		.num_temp_limit = 6,
 		.num_temp_offset = 3,
 		.num_temp_map = 3,
@@ -711,7 +796,7 @@ static const struct it87_devices it87_devices[] = {
 		.features = FEAT_NEWER_AUTOPWM | FEAT_16BIT_FANS
 			| FEAT_AVCC3 | FEAT_NEW_TEMPMAP | FEAT_SCALING
 			| FEAT_10_9MV_ADC | FEAT_IN7_INTERNAL | FEAT_BANK_SEL
-			| FEAT_SIX_TEMP | FEAT_MMIO,
+			| FEAT_SIX_TEMP | FEAT_MMIO | FEAT_FAST_IO,
 		.num_temp_limit = 6,
 		.num_temp_offset = 6,
 		.num_temp_map = 6,
@@ -723,7 +808,8 @@ static const struct it87_devices it87_devices[] = {
 		.features = FEAT_NEWER_AUTOPWM | FEAT_16BIT_FANS
 			| FEAT_AVCC3 | FEAT_NEW_TEMPMAP | FEAT_SCALING
 			| FEAT_10_9MV_ADC | FEAT_IN7_INTERNAL | FEAT_SIX_FANS
-			| FEAT_SIX_PWM | FEAT_BANK_SEL | FEAT_MMIO | FEAT_SIX_TEMP,
+			| FEAT_SIX_PWM | FEAT_BANK_SEL | FEAT_MMIO | FEAT_SIX_TEMP
+			| FEAT_FAST_IO,
 		.num_temp_limit = 6,
 		.num_temp_offset = 6,
 		.num_temp_map = 6,
@@ -732,7 +818,8 @@ static const struct it87_devices it87_devices[] = {
 	[it8686] = {
 		.name = "it8686",
 		.model = "IT8686E",
-		.features = FEAT_NEWER_AUTOPWM | FEAT_12MV_ADC | FEAT_16BIT_FANS | FEAT_SIX_FANS | FEAT_NEW_TEMPMAP | FEAT_IN7_INTERNAL | FEAT_SIX_PWM | FEAT_PWM_FREQ2 | FEAT_SIX_TEMP | FEAT_BANK_SEL | FEAT_SCALING | FEAT_AVCC3,
+		.features = FEAT_NEWER_AUTOPWM | FEAT_12MV_ADC | FEAT_16BIT_FANS | FEAT_SIX_FANS | FEAT_NEW_TEMPMAP | FEAT_IN7_INTERNAL | FEAT_SIX_PWM | FEAT_PWM_FREQ2 | FEAT_SIX_TEMP | FEAT_BANK_SEL | FEAT_SCALING | FEAT_AVCC3
+			| FEAT_FAST_IO,
 		.num_temp_limit = 6,
 		.num_temp_offset = 6,
 		.num_temp_map = 7,
@@ -744,7 +831,8 @@ static const struct it87_devices it87_devices[] = {
 		.features = FEAT_NEWER_AUTOPWM | FEAT_12MV_ADC | FEAT_16BIT_FANS
 			| FEAT_SIX_FANS | FEAT_NEW_TEMPMAP
 			| FEAT_IN7_INTERNAL | FEAT_SIX_PWM | FEAT_PWM_FREQ2
-			| FEAT_SIX_TEMP | FEAT_BANK_SEL | FEAT_SCALING | FEAT_AVCC3,
+			| FEAT_SIX_TEMP | FEAT_BANK_SEL | FEAT_SCALING | FEAT_AVCC3
+			| FEAT_FAST_IO,
 		.num_temp_limit = 6,
 		.num_temp_offset = 6,
 		.num_temp_map = 7,
@@ -756,7 +844,8 @@ static const struct it87_devices it87_devices[] = {
 		.features = FEAT_NEWER_AUTOPWM | FEAT_12MV_ADC | FEAT_16BIT_FANS
 			| FEAT_SIX_FANS | FEAT_NEW_TEMPMAP
 			| FEAT_IN7_INTERNAL | FEAT_SIX_PWM | FEAT_PWM_FREQ2
-			| FEAT_SIX_TEMP | FEAT_BANK_SEL | FEAT_SCALING | FEAT_AVCC3,
+			| FEAT_SIX_TEMP | FEAT_BANK_SEL | FEAT_SCALING | FEAT_AVCC3
+			| FEAT_FAST_IO,
 		.num_temp_limit = 6,
 		.num_temp_offset = 6,
 		.num_temp_map = 7,
@@ -767,7 +856,8 @@ static const struct it87_devices it87_devices[] = {
 		.model = "IT8695E",
 		.features = FEAT_NEWER_AUTOPWM | FEAT_10_9MV_ADC | FEAT_SCALING
 			| FEAT_16BIT_FANS | FEAT_TEMP_PECI
-			| FEAT_IN7_INTERNAL | FEAT_PWM_FREQ2 | FEAT_FANCTL_ONOFF,
+			| FEAT_IN7_INTERNAL | FEAT_PWM_FREQ2 | FEAT_FANCTL_ONOFF
+			| FEAT_FAST_IO,
 		.num_temp_limit = 3,
 		.num_temp_offset = 3,
 		.num_temp_map = 3,
@@ -810,6 +900,7 @@ static const struct it87_devices it87_devices[] = {
 #define has_11mv_adc(data)	((data)->features & FEAT_11MV_ADC)
 #define has_new_tempmap(data)	((data)->features & FEAT_NEW_TEMPMAP)
 #define has_mmio(data)		((data)->features & FEAT_MMIO)
+#define has_fast_io(data)	((data)->features & FEAT_FAST_IO)
 #define has_four_temp(data)	((data)->features & FEAT_FOUR_TEMP)
 
 struct it87_sio_data {
@@ -831,12 +922,57 @@ struct it87_sio_data {
 	u8 ec_special_config;
 };
 
+/*
+ * One register read of the update snapshot. The register value is stored
+ * in the byte at bit position @shift of the @size byte wide field @val
+ * points to, so 16-bit fan counts and the 24-bit alarm mask can be
+ * assembled from individual register reads in any order.
+ */
+struct it87_snap_op {
+	u16 reg;	/* Register address, bank in bits 15-8 */
+	u8 group;	/* Cache group, IT87_SNAP_INPUT/CONFIG(slice) */
+	u8 size;	/* Size of *val in bytes (1, 2 or 4) */
+	u8 shift;	/* Bit position of the register value in *val */
+	void *val;
+};
+
+/*
+ * Settings and state of the in-driver fan control loop of one PWM output,
+ * a PI controller on the temperature selected by pwmN_auto_channels_temp.
+ */
+struct it87_fan_loop {
+	int target;		/* Temperature, millidegree C */
+	u8 min;			/* Output limits, 0-255 */
+	u8 max;
+	u8 step;		/* Largest output change per period, 0 = any */
+	u8 out;			/* Last output written, 0-255 */
+	int integral;		/* Integral term, 1/1000 PWM steps */
+};
+
+/* Cooling device of one PWM output, for the thermal framework */
+struct it87_cooling {
+	struct it87_data *data;
+	int nr;
+};
+
+/*
+ * Measured values published by the background sampler. Readers copy the
+ * current buffer without taking update_lock, see it87_get_sample().
+ */
+struct it87_sample {
+	u8 in[NUM_VIN];
+	u16 fan[NUM_FAN];
+	u8 fan_div[NUM_FAN_DIV];
+	s8 temp[NUM_TEMP];
+	u32 alarms;
+};
+
 /*
  * For each registered chip, we need to keep some data in memory.
  * The structure is dynamically allocated.
  */
 struct it87_data {
-	const struct attribute_group *groups[7 + 1]; /* +1 for the gpled group */
+	const struct attribute_group *groups[4 + 1];
 	enum chips type;
 	u32 features;
 	u8 peci_mask;
@@ -844,6 +980,8 @@ struct it87_data {
 
 	u8 smbus_bitmap;  /* !=0 if SMBus needs to be disabled */
 	u8 saved_bank;    /* saved bank register value */
+	u8 bank_reg;	/* bank register value, while bank_valid */
+	bool bank_valid;
 	u8 ec_special_config;  /* EC special config register restore value */
 	u8 sioaddr;    /* SIO port address */
 	bool doexit;    /* true if exit from sio config is ok */
@@ -865,8 +1003,35 @@ struct it87_data {
 
 	unsigned short addr;
 	struct mutex update_lock;
-	bool valid;		/* true if following fields are valid */
-	unsigned long last_updated;	/* In jiffies */
+	unsigned int update_interval;	/* In milliseconds, inputs */
+
+	/* Registers read on update, sorted by bank (built at probe time) */
+	struct it87_snap_op *snap_ops;
+	int snap_nr_ops;
+	int snap_start[IT87_SNAP_GROUPS + 1];	/* First op per group */
+	DECLARE_BITMAP(snap_valid, IT87_SNAP_GROUPS);	/* Cached groups */
+	unsigned long snap_updated[IT87_SNAP_GROUPS];	/* In jiffies */
+	u32 port_cycles;	/* EC address/data port accesses */
+	u32 bank_switches;	/* Writes to IT87_REG_BANK */
+	u32 smbus_toggles;	/* SMBus disable/enable sequences */
+	u32 refreshes;		/* Register cache updates */
+	u32 refresh_port_cycles;	/* Port accesses of the last update */
+	u32 refresh_bank_switches;	/* Bank switches of the last update */
+	u64 refresh_ns;		/* Duration of the last update */
+	u64 updated_ns;		/* Monotonic time of the last update */
+	u32 access_ns;		/* Cost of one register read, from probe */
+	u32 mmio_access_ns;	/* Same over MMIO, 0 if unusable */
+	u32 io_access_ns;	/* Same over port I/O, 0 if unavailable */
+	struct dentry *debugfs;
+
+	struct device *dev;
+
+	/* Background sampler, only used if sample_interval is set */
+	struct delayed_work sampler;
+	unsigned long sample_period;	/* In jiffies, 0 if disabled */
+	seqcount_t sample_seq;		/* Protects sample_idx */
+	int sample_idx;			/* Buffer read by readers */
+	struct it87_sample sample[2];
 
 	u16 in_scaled;		/* Internal voltage sensors are scaled */
 	u16 in_internal;	/* Bitfield, internal sensors (for labels) */
@@ -875,12 +1040,14 @@ struct it87_data {
 	u8 has_fan;		/* Bitfield, fans enabled */
 	u16 fan[NUM_FAN][2];	/* Register values, [nr][0]=fan, [1]=min */
 	u8 has_temp;		/* Bitfield, temp sensors enabled */
+	u8 has_temp_type;	/* Bitfield, temp sensors with a type */
 	s8 temp[NUM_TEMP][4];	/* [nr][0]=temp, [1]=min, [2]=max, [3]=offset */
 	u8 num_temp_limit;	/* Number of temperature limit registers */
 	u8 num_temp_offset;	/* Number of temperature offset registers */
 	u8 temp_src[4];		/* Up to 4 temperature source registers */
 	u8 sensor;		/* Register value (IT87_REG_TEMP_ENABLE) */
 	u8 extra;		/* Register value (IT87_REG_TEMP_EXTRA) */
+	u8 fan_div_reg;		/* Register value (IT87_REG_FAN_DIV) */
 	u8 fan_div[NUM_FAN_DIV];/* Register encoding, shifted right */
 	bool has_vid;		/* True if VID supported */
 	u8 vid;			/* Register encoding, combined */
@@ -912,6 +1079,13 @@ struct it87_data {
 	/* Automatic fan speed control registers */
 	u8 auto_pwm[NUM_AUTO_PWM][4];	/* [nr][3] is hard-coded */
 	s8 auto_temp[NUM_AUTO_PWM][5];	/* [nr][0] is point1_temp_hyst */
+
+	/* Fan control loop, pwmN_enable=3 */
+	struct delayed_work fan_loop_work;
+	u8 fan_loop_mask;		/* Bitfield, PWM outputs under control */
+	struct it87_fan_loop fan_loop[NUM_PWM];
+
+	struct it87_cooling cooling[NUM_PWM];
 };
 
 static int adc_lsb(const struct it87_data *data, int nr)
@@ -1034,14 +1208,29 @@ static const unsigned int pwm_freq[8] = {
 	750000,
 };
 
+/*
+ * Legacy chips like the IT8705F and IT8712F need the paused port
+ * accessors, newer chips keep up with back-to-back LPC cycles.
+ */
 static int _it87_io_read(struct it87_data *data, u16 reg)
 {
+	data->port_cycles += 2;
+	if (has_fast_io(data)) {
+		outb(reg, data->addr + IT87_ADDR_REG_OFFSET);
+		return inb(data->addr + IT87_DATA_REG_OFFSET);
+	}
 	outb_p(reg, data->addr + IT87_ADDR_REG_OFFSET);
 	return inb_p(data->addr + IT87_DATA_REG_OFFSET);
 }
 
 static void _it87_io_write(struct it87_data *data, u16 reg, u8 value)
 {
+	data->port_cycles += 2;
+	if (has_fast_io(data)) {
+		outb(reg, data->addr + IT87_ADDR_REG_OFFSET);
+		outb(value, data->addr + IT87_DATA_REG_OFFSET);
+		return;
+	}
 	outb_p(reg, data->addr + IT87_ADDR_REG_OFFSET);
 	outb_p(value, data->addr + IT87_DATA_REG_OFFSET);
 }
@@ -1050,6 +1239,9 @@ static int smbus_disable(struct it87_data *data)
 {
 	int err;
 
+	/* The firmware may have switched banks while it owned the EC */
+	data->bank_valid = false;
+
 	if (data->smbus_bitmap) {
 		err = superio_enter(data->sioaddr);
 		if (err)
@@ -1058,19 +1250,29 @@ static int smbus_disable(struct it87_data *data)
 		superio_outb(data->sioaddr, IT87_SPECIAL_CFG_REG,
 				data->ec_special_config & ~data->smbus_bitmap);
 		superio_exit(data->sioaddr, data->doexit);
-		if (has_bank_sel(data) && !data->mmio)
-			data->saved_bank = _it87_io_read(data, IT87_REG_BANK);
+		data->smbus_toggles++;
 	}
 	return 0;
 }
 
+/* Switch back to the bank the EC was found in, and drop the bank cache */
+static void it87_io_restore_bank(struct it87_data *data)
+{
+	if (data->bank_valid) {
+		if (data->bank_reg != data->saved_bank)
+			_it87_io_write(data, IT87_REG_BANK, data->saved_bank);
+		data->bank_valid = false;
+	}
+}
+
 static int smbus_enable(struct it87_data *data)
 {
 	int err;
 
+	/* Hand the EC back in the bank it was found in */
+	it87_io_restore_bank(data);
+
 	if (data->smbus_bitmap) {
-		if (has_bank_sel(data) && !data->mmio)
-			_it87_io_write(data, IT87_REG_BANK, data->saved_bank);
 		err = superio_enter(data->sioaddr);
 		if (err)
 			return err;
@@ -1083,21 +1285,27 @@ static int smbus_enable(struct it87_data *data)
 	return 0;
 }
 
-static u8 it87_io_set_bank(struct it87_data *data, u8 bank)
+/*
+ * The bank register is read once after smbus_disable() and then tracked
+ * in bank_reg, so only actual bank changes cost a port access. The cache
+ * is dropped by smbus_disable(), and the original bank restored by
+ * smbus_enable().
+ */
+static void it87_io_set_bank(struct it87_data *data, u8 bank)
 {
-	u8 _bank = bank;
+	if (!has_bank_sel(data))
+		return;
 
-	if (has_bank_sel(data)) {
-		u8 breg = _it87_io_read(data, IT87_REG_BANK);
-
-		_bank = breg >> 5;
-		if (bank != _bank) {
-			breg &= 0x1f;
-			breg |= (bank << 5);
-			_it87_io_write(data, IT87_REG_BANK, breg);
-		}
+	if (!data->bank_valid) {
+		data->bank_reg = _it87_io_read(data, IT87_REG_BANK);
+		data->saved_bank = data->bank_reg;
+		data->bank_valid = true;
+	}
+	if (bank != data->bank_reg >> 5) {
+		data->bank_reg = (data->bank_reg & 0x1f) | (bank << 5);
+		_it87_io_write(data, IT87_REG_BANK, data->bank_reg);
+		data->bank_switches++;
 	}
-	return _bank;
 }
 
 /*
@@ -1108,14 +1316,8 @@ static u8 it87_io_set_bank(struct it87_data *data, u8 bank)
  */
 static int it87_io_read(struct it87_data *data, u16 reg)
 {
-	u8 bank;
-	int val;
-
-	bank = it87_io_set_bank(data, reg >> 8);
-	val = _it87_io_read(data, reg & 0xff);
-	it87_io_set_bank(data, bank);
-
-	return val;
+	it87_io_set_bank(data, reg >> 8);
+	return _it87_io_read(data, reg & 0xff);
 }
 
 /*
@@ -1126,11 +1328,8 @@ static int it87_io_read(struct it87_data *data, u16 reg)
  */
 static void it87_io_write(struct it87_data *data, u16 reg, u8 value)
 {
-	u8 bank;
-
-	bank = it87_io_set_bank(data, reg >> 8);
+	it87_io_set_bank(data, reg >> 8);
 	_it87_io_write(data, reg & 0xff, value);
-	it87_io_set_bank(data, bank);
 }
 
 static int it87_mmio_read(struct it87_data *data, u16 reg)
@@ -1143,21 +1342,27 @@ static void it87_mmio_write(struct it87_data *data, u16 reg, u8 value)
 	writeb(value, data->mmio + reg);
 }
 
-static void it87_update_pwm_ctrl(struct it87_data *data, int nr)
+/* Derive the temperature mapping and manual duty cycle from pwm_ctrl[nr] */
+static void it87_decode_pwm_ctrl(struct it87_data *data, int nr)
 {
-	u8 ctrl;
+	u8 ctrl = data->pwm_ctrl[nr];
 
-	ctrl = data->read(data, data->REG_PWM[nr]);
-	data->pwm_ctrl[nr] = ctrl;
 	if (has_newer_autopwm(data)) {
 		data->pwm_temp_map[nr] = temp_map_from_reg(data, ctrl);
-		data->pwm_duty[nr] = data->read(data, IT87_REG_PWM_DUTY[nr]);
 	} else {
 		if (ctrl & 0x80)  /* Automatic mode */
 			data->pwm_temp_map[nr] = temp_map_from_reg(data, ctrl);
 		else        /* Manual mode */
 			data->pwm_duty[nr] = ctrl & 0x7f;
 	}
+}
+
+static void it87_update_pwm_ctrl(struct it87_data *data, int nr)
+{
+	data->pwm_ctrl[nr] = data->read(data, data->REG_PWM[nr]);
+	if (has_newer_autopwm(data))
+		data->pwm_duty[nr] = data->read(data, IT87_REG_PWM_DUTY[nr]);
+	it87_decode_pwm_ctrl(data, nr);
 
 	if (has_old_autopwm(data)) {
 		int i;
@@ -1194,6 +1399,240 @@ static void it87_update_pwm_ctrl(struct it87_data *data, int nr)
 	}
 }
 
+static void it87_snap_add(struct it87_data *data, u8 group, u16 reg,
+			  void *val, u8 size, u8 shift)
+{
+	struct it87_snap_op *op = &data->snap_ops[data->snap_nr_ops++];
+
+	op->reg = reg;
+	op->group = group;
+	op->val = val;
+	op->size = size;
+	op->shift = shift;
+}
+
+#define it87_snap(data, group, reg, field, shift) \
+	it87_snap_add(data, group, reg, &(field), sizeof(field), shift)
+
+static int it87_snap_cmp(const void *a, const void *b)
+{
+	const struct it87_snap_op *op_a = a, *op_b = b;
+
+	if (op_a->group != op_b->group)
+		return op_a->group - op_b->group;
+
+	/* Sorting by address groups registers by bank */
+	return op_a->reg - op_b->reg;
+}
+
+/*
+ * Build the list of registers to read in it87_update_device(). Disabled
+ * channels are skipped, and the list is sorted by cache group, then by
+ * register address so that the slice of each group is ordered by bank.
+ * Low bytes of 16-bit fan registers are at lower addresses than the high
+ * bytes, so the sort preserves the low byte first read order.
+ */
+static int it87_init_snapshot(struct device *dev, struct it87_data *data)
+{
+	struct it87_snap_op *op;
+	int i, in, cfg, group;
+
+	data->snap_ops = devm_kcalloc(dev, IT87_SNAP_MAX_OPS,
+				      sizeof(*data->snap_ops), GFP_KERNEL);
+	if (!data->snap_ops)
+		return -ENOMEM;
+
+	for (i = 0; i < NUM_VIN; i++) {
+		if (!(data->has_in & BIT(i)))
+			continue;
+
+		in = IT87_SNAP_INPUT(IT87_SLICE_IN(i));
+		cfg = IT87_SNAP_CONFIG(IT87_SLICE_IN(i));
+
+		it87_snap(data, in, IT87_REG_VIN[i], data->in[i][0], 0);
+
+		/* VBAT and AVCC don't have limit registers */
+		if (i >= NUM_VIN_LIMIT)
+			continue;
+
+		it87_snap(data, cfg, IT87_REG_VIN_MIN(i), data->in[i][1], 0);
+		it87_snap(data, cfg, IT87_REG_VIN_MAX(i), data->in[i][2], 0);
+	}
+
+	for (i = 0; i < NUM_FAN; i++) {
+		/* Skip disabled fans */
+		if (!(data->has_fan & BIT(i)))
+			continue;
+
+		in = IT87_SNAP_INPUT(IT87_SLICE_FAN(i));
+		cfg = IT87_SNAP_CONFIG(IT87_SLICE_FAN(i));
+
+		it87_snap(data, cfg, data->REG_FAN_MIN[i], data->fan[i][1], 0);
+		it87_snap(data, in, data->REG_FAN[i], data->fan[i][0], 0);
+		/* Add high byte if in 16-bit mode */
+		if (has_16bit_fans(data)) {
+			it87_snap(data, in, data->REG_FANX[i],
+				  data->fan[i][0], 8);
+			it87_snap(data, cfg, data->REG_FANX_MIN[i],
+				  data->fan[i][1], 8);
+		}
+	}
+
+	for (i = 0; i < NUM_TEMP; i++) {
+		if (!(data->has_temp & BIT(i)))
+			continue;
+
+		in = IT87_SNAP_INPUT(IT87_SLICE_TEMP(i));
+		cfg = IT87_SNAP_CONFIG(IT87_SLICE_TEMP(i));
+
+		it87_snap(data, in, IT87_REG_TEMP(i), data->temp[i][0], 0);
+
+		if (i >= data->num_temp_limit)
+			continue;
+
+		if (i < data->num_temp_offset)
+			it87_snap(data, cfg, data->REG_TEMP_OFFSET[i],
+				  data->temp[i][3], 0);
+
+		it87_snap(data, cfg, data->REG_TEMP_LOW[i],
+			  data->temp[i][1], 0);
+		it87_snap(data, cfg, data->REG_TEMP_HIGH[i],
+			  data->temp[i][2], 0);
+	}
+
+	in = IT87_SNAP_INPUT(IT87_SLICE_ALARM);
+	cfg = IT87_SNAP_CONFIG(IT87_SLICE_ALARM);
+	it87_snap(data, in, IT87_REG_ALARM1, data->alarms, 0);
+	it87_snap(data, in, IT87_REG_ALARM2, data->alarms, 8);
+	it87_snap(data, in, IT87_REG_ALARM3, data->alarms, 16);
+	it87_snap(data, cfg, IT87_REG_BEEP_ENABLE, data->beeps, 0);
+
+	cfg = IT87_SNAP_CONFIG(IT87_SLICE_CTRL);
+	/* Newer chips don't have clock dividers */
+	if ((data->has_fan & 0x07) && !has_16bit_fans(data))
+		it87_snap(data, cfg, IT87_REG_FAN_DIV, data->fan_div_reg, 0);
+	it87_snap(data, cfg, IT87_REG_FAN_MAIN_CTRL, data->fan_main_ctrl, 0);
+	it87_snap(data, cfg, IT87_REG_FAN_CTL, data->fan_ctl, 0);
+	it87_snap(data, cfg, IT87_REG_TEMP_ENABLE, data->sensor, 0);
+	it87_snap(data, cfg, IT87_REG_TEMP_EXTRA, data->extra, 0);
+	/*
+	 * The IT8705F does not have VID capability.
+	 * The IT8718F and later don't use IT87_REG_VID for the
+	 * same purpose.
+	 */
+	if (data->type == it8712 || data->type == it8716)
+		it87_snap(data, cfg, IT87_REG_VID, data->vid, 0);
+
+	for (i = 0; i < NUM_PWM; i++) {
+		int j;
+
+		if (!(data->has_pwm & BIT(i)))
+			continue;
+
+		in = IT87_SNAP_INPUT(IT87_SLICE_PWM(i));
+		cfg = IT87_SNAP_CONFIG(IT87_SLICE_PWM(i));
+
+		it87_snap(data, cfg, data->REG_PWM[i], data->pwm_ctrl[i], 0);
+
+		if (has_old_autopwm(data)) {
+			for (j = 0; j < 5; j++)
+				it87_snap(data, cfg, IT87_REG_AUTO_TEMP(i, j),
+					  data->auto_temp[i][j], 0);
+			for (j = 0; j < 3; j++)
+				it87_snap(data, cfg, IT87_REG_AUTO_PWM(i, j),
+					  data->auto_pwm[i][j], 0);
+		} else if (has_newer_autopwm(data)) {
+			/* Follows the temperature in automatic mode */
+			it87_snap(data, in, IT87_REG_PWM_DUTY[i],
+				  data->pwm_duty[i], 0);
+			/* See it87_update_pwm_ctrl() for the layout */
+			it87_snap(data, cfg, IT87_REG_AUTO_TEMP(i, 5),
+				  data->auto_temp[i][0], 0);
+			for (j = 0; j < 3; j++)
+				it87_snap(data, cfg, IT87_REG_AUTO_TEMP(i, j),
+					  data->auto_temp[i][j + 1], 0);
+			it87_snap(data, cfg, IT87_REG_AUTO_TEMP(i, 3),
+				  data->auto_pwm[i][0], 0);
+			it87_snap(data, cfg, IT87_REG_AUTO_TEMP(i, 4),
+				  data->auto_pwm[i][1], 0);
+		}
+	}
+
+	sort(data->snap_ops, data->snap_nr_ops, sizeof(*data->snap_ops),
+	     it87_snap_cmp, NULL);
+
+	/* Each group is now a contiguous slice of the list */
+	group = 0;
+	for (i = 0; i < data->snap_nr_ops; i++) {
+		op = &data->snap_ops[i];
+		while (group <= op->group)
+			data->snap_start[group++] = i;
+	}
+	while (group <= IT87_SNAP_GROUPS)
+		data->snap_start[group++] = data->snap_nr_ops;
+
+	return 0;
+}
+
+static void it87_snap_store(const struct it87_snap_op *op, u8 val)
+{
+	switch (op->size) {
+	case 1:
+		*(u8 *)op->val = val;
+		break;
+	case 2:
+		*(u16 *)op->val &= ~(0xff << op->shift);
+		*(u16 *)op->val |= val << op->shift;
+		break;
+	case 4:
+		*(u32 *)op->val &= ~(0xff << op->shift);
+		*(u32 *)op->val |= val << op->shift;
+		break;
+	}
+}
+
+/*
+ * Read the registers of the cache groups set in @groups in a single pass
+ * over the banks: each bank is read for all groups before moving to the
+ * next one. Every group slice is sorted by bank, and it87_io_set_bank()
+ * only switches when the bank changes, so banked chips switch once per
+ * bank, however many groups are stale.
+ * Must be called with data->update_lock held and SMBus accesses disabled.
+ */
+static void it87_snap_read(struct it87_data *data, const unsigned long *groups)
+{
+	u16 pos[IT87_SNAP_GROUPS];
+	const struct it87_snap_op *op;
+	int g, bank, next;
+
+	for_each_set_bit(g, groups, IT87_SNAP_GROUPS)
+		pos[g] = data->snap_start[g];
+
+	for (bank = 0; bank >= 0; bank = next) {
+		next = -1;
+		for_each_set_bit(g, groups, IT87_SNAP_GROUPS) {
+			for (; pos[g] < data->snap_start[g + 1]; pos[g]++) {
+				op = &data->snap_ops[pos[g]];
+				if (op->reg >> 8 != bank)
+					break;
+				it87_snap_store(op, data->read(data, op->reg));
+			}
+			/* Lowest bank still to read, in any group */
+			if (pos[g] < data->snap_start[g + 1]) {
+				op = &data->snap_ops[pos[g]];
+				if (next < 0 || op->reg >> 8 < next)
+					next = op->reg >> 8;
+			}
+		}
+	}
+}
+
+/* Force a refresh of all registers on the next update */
+static void it87_invalidate(struct it87_data *data)
+{
+	bitmap_zero(data->snap_valid, IT87_SNAP_GROUPS);
+}
+
 static int it87_lock(struct it87_data *data)
 {
 	int err;
@@ -1211,320 +1650,273 @@ static void it87_unlock(struct it87_data *data)
 	mutex_unlock(&data->update_lock);
 }
 
-static struct it87_data *it87_update_device(struct device *dev)
+/*
+ * Fill the buffer readers don't use and flip it in. A reader racing with
+ * the flip retries, and a buffer is only rewritten after it has been
+ * flipped out, so readers never see a half-written sample.
+ * Must be called with data->update_lock held.
+ */
+static void it87_publish_sample(struct it87_data *data)
+{
+	struct it87_sample *s = &data->sample[!data->sample_idx];
+	int i;
+
+	for (i = 0; i < NUM_VIN; i++)
+		s->in[i] = data->in[i][0];
+	for (i = 0; i < NUM_FAN; i++)
+		s->fan[i] = data->fan[i][0];
+	for (i = 0; i < NUM_TEMP; i++)
+		s->temp[i] = data->temp[i][0];
+	memcpy(s->fan_div, data->fan_div, sizeof(s->fan_div));
+	s->alarms = data->alarms;
+
+	preempt_disable();
+	write_seqcount_begin(&data->sample_seq);
+	data->sample_idx = !data->sample_idx;
+	write_seqcount_end(&data->sample_seq);
+	preempt_enable();
+}
+
+/*
+ * Copy the last published sample. Returns false if the sampler is
+ * disabled, the caller then reads through it87_update_device().
+ */
+static bool it87_get_sample(struct it87_data *data, struct it87_sample *s)
+{
+	unsigned int seq;
+
+	if (!data->sample_period)
+		return false;
+
+	do {
+		seq = read_seqcount_begin(&data->sample_seq);
+		*s = data->sample[data->sample_idx];
+	} while (read_seqcount_retry(&data->sample_seq, seq));
+	return true;
+}
+
+/*
+ * Refresh the stale cache groups of the slices in @slices, a bitmask of
+ * IT87_SLICE_*() values.
+ */
+static struct it87_data *it87_update_device(struct device *dev, u64 slices)
 {
 	struct it87_data *data = dev_get_drvdata(dev);
+	DECLARE_BITMAP(stale, IT87_SNAP_GROUPS);
 	struct it87_data *ret = data;
+	unsigned long lifetime[2];
+	u32 cycles, switches;
+	bool inputs = false;
+	u64 start;
 	int err;
-	int i;
+	int g, i;
 
 	mutex_lock(&data->update_lock);
 
-	if (time_after(jiffies, data->last_updated + HZ + HZ / 2) ||
-	    !data->valid) {
+	/* Indexed by group number modulo 2, i.e. input or config */
+	lifetime[0] = msecs_to_jiffies(data->update_interval);
+	lifetime[1] = msecs_to_jiffies(config_interval);
+
+	bitmap_zero(stale, IT87_SNAP_GROUPS);
+	for (g = 0; g < IT87_SNAP_GROUPS; g++) {
+		if (!(slices & BIT_ULL(g / 2)))
+			continue;
+		if (!test_bit(g, data->snap_valid) ||
+		    time_after(jiffies,
+			       data->snap_updated[g] + lifetime[g % 2])) {
+			__set_bit(g, stale);
+			inputs |= g % 2 == 0;
+		}
+	}
+
+	if (!bitmap_empty(stale, IT87_SNAP_GROUPS)) {
+		start = ktime_get_ns();
+		cycles = data->port_cycles;
+		switches = data->bank_switches;
 		err = smbus_disable(data);
 		if (err) {
 			ret = ERR_PTR(err);
 			goto unlock;
 		}
-		if (update_vbat) {
+		if (update_vbat && inputs) {
 			/*
-			 * Cleared after each update, so reenable.  Value
-			 * returned by this read will be previous value
+			 * Cleared after each update, so reenable whenever
+			 * measured values are read.  Value returned by this
+			 * read will be previous value
 			 */
 			data->write(data, IT87_REG_CONFIG,
 				    data->read(data, IT87_REG_CONFIG) | 0x40);
 		}
-		for (i = 0; i < NUM_VIN; i++) {
-			if (!(data->has_in & BIT(i)))
-				continue;
-
-			data->in[i][0] = data->read(data, IT87_REG_VIN[i]);
-
-			/* VBAT and AVCC don't have limit registers */
-			if (i >= NUM_VIN_LIMIT)
-				continue;
-
-			data->in[i][1] = data->read(data, IT87_REG_VIN_MIN(i));
-			data->in[i][2] = data->read(data, IT87_REG_VIN_MAX(i));
-		}
-
-		for (i = 0; i < NUM_FAN; i++) {
-			/* Skip disabled fans */
-			if (!(data->has_fan & BIT(i)))
-				continue;
-
-			data->fan[i][1] = data->read(data,
-					data->REG_FAN_MIN[i]);
-			data->fan[i][0] = data->read(data, data->REG_FAN[i]);
-			/* Add high byte if in 16-bit mode */
-			if (has_16bit_fans(data)) {
-				data->fan[i][0] |= data->read(data,
-						data->REG_FANX[i]) << 8;
-				data->fan[i][1] |= data->read(data,
-						data->REG_FANX_MIN[i]) << 8;
-			}
-		}
-		for (i = 0; i < NUM_TEMP; i++) {
-			if (!(data->has_temp & BIT(i)))
-				continue;
-			data->temp[i][0] =
-				data->read(data, IT87_REG_TEMP(i));
 
-			if (i >= data->num_temp_limit)
-				continue;
-
-			if (i < data->num_temp_offset)
-				data->temp[i][3] =
-					data->read(data, data->REG_TEMP_OFFSET[i]);
-
-			data->temp[i][1] =
-				data->read(data, data->REG_TEMP_LOW[i]);
-			data->temp[i][2] =
-				data->read(data, data->REG_TEMP_HIGH[i]);
-		}
+		it87_snap_read(data, stale);
 
 		/* Newer chips don't have clock dividers */
-		if ((data->has_fan & 0x07) && !has_16bit_fans(data)) {
-			i = data->read(data, IT87_REG_FAN_DIV);
+		if (test_bit(IT87_SNAP_CONFIG(IT87_SLICE_CTRL), stale) &&
+		    (data->has_fan & 0x07) && !has_16bit_fans(data)) {
+			i = data->fan_div_reg;
 			data->fan_div[0] = i & 0x07;
 			data->fan_div[1] = (i >> 3) & 0x07;
 			data->fan_div[2] = (i & 0x40) ? 3 : 1;
 		}
 
-		data->alarms =
-			data->read(data, IT87_REG_ALARM1) |
-			(data->read(data, IT87_REG_ALARM2) << 8) |
-			(data->read(data, IT87_REG_ALARM3) << 16);
-		data->beeps = data->read(data, IT87_REG_BEEP_ENABLE);
-
-		data->fan_main_ctrl = data->read(data, IT87_REG_FAN_MAIN_CTRL);
-		data->fan_ctl = data->read(data, IT87_REG_FAN_CTL);
 		for (i = 0; i < NUM_PWM; i++) {
-			if (!(data->has_pwm & BIT(i)))
+			if (!(data->has_pwm & BIT(i)) ||
+			    !(slices & BIT_ULL(IT87_SLICE_PWM(i))))
 				continue;
-			it87_update_pwm_ctrl(data, i);
+			it87_decode_pwm_ctrl(data, i);
 		}
 
-		data->sensor = data->read(data, IT87_REG_TEMP_ENABLE);
-		data->extra = data->read(data, IT87_REG_TEMP_EXTRA);
 		/*
-		 * The IT8705F does not have VID capability.
-		 * The IT8718F and later don't use IT87_REG_VID for the
-		 * same purpose.
+		 * The older IT8712F revisions had only 5 VID pins,
+		 * but we assume it is always safe to read 6 bits.
 		 */
-		if (data->type == it8712 || data->type == it8716) {
-			data->vid = data->read(data, IT87_REG_VID);
-			/*
-			 * The older IT8712F revisions had only 5 VID pins,
-			 * but we assume it is always safe to read 6 bits.
-			 */
+		if (data->type == it8712 || data->type == it8716)
 			data->vid &= 0x3f;
-		}
 
-		data->last_updated = jiffies;
-		data->valid = true;
+		for_each_set_bit(g, stale, IT87_SNAP_GROUPS)
+			data->snap_updated[g] = jiffies;
+		bitmap_or(data->snap_valid, data->snap_valid, stale,
+			  IT87_SNAP_GROUPS);
 		smbus_enable(data);
+
+		data->refreshes++;
+		data->refresh_port_cycles = data->port_cycles - cycles;
+		data->refresh_bank_switches = data->bank_switches - switches;
+		data->refresh_ns = ktime_get_ns() - start;
+		data->updated_ns = start;
+
+		if (data->sample_period)
+			it87_publish_sample(data);
 	}
 unlock:
 	mutex_unlock(&data->update_lock);
 	return ret;
 }
 
-static ssize_t show_in(struct device *dev, struct device_attribute *attr,
-		       char *buf)
+/* Alarm and beep bits are shared by all channels of a sensor class */
+static int it87_read_alarm(struct device *dev, int bitnr, long *val)
 {
-	struct sensor_device_attribute_2 *sattr = to_sensor_dev_attr_2(attr);
-	struct it87_data *data = it87_update_device(dev);
-	int index = sattr->index;
-	int nr = sattr->nr;
+	struct it87_data *data = dev_get_drvdata(dev);
+	struct it87_sample s;
+
+	if (it87_get_sample(data, &s)) {
+		*val = (s.alarms >> bitnr) & 1;
+		return 0;
+	}
+
+	data = it87_update_device(dev, BIT_ULL(IT87_SLICE_ALARM));
+	if (IS_ERR(data))
+		return PTR_ERR(data);
+
+	*val = (data->alarms >> bitnr) & 1;
+	return 0;
+}
+
+static int it87_read_beep(struct device *dev, int bitnr, long *val)
+{
+	struct it87_data *data;
 
+	data = it87_update_device(dev, BIT_ULL(IT87_SLICE_ALARM));
 	if (IS_ERR(data))
 		return PTR_ERR(data);
 
-	return sprintf(buf, "%d\n", in_from_reg(data, nr, data->in[nr][index]));
+	*val = (data->beeps >> bitnr) & 1;
+	return 0;
 }
 
-static ssize_t set_in(struct device *dev, struct device_attribute *attr,
-		      const char *buf, size_t count)
+static int it87_write_beep(struct device *dev, int bitnr, long val)
 {
-	struct sensor_device_attribute_2 *sattr = to_sensor_dev_attr_2(attr);
 	struct it87_data *data = dev_get_drvdata(dev);
-	int index = sattr->index;
-	int nr = sattr->nr;
-	unsigned long val;
 	int err;
 
-	if (kstrtoul(buf, 10, &val) < 0)
+	if (val != 0 && val != 1)
 		return -EINVAL;
 
 	err = it87_lock(data);
 	if (err)
 		return err;
 
-	data->in[nr][index] = in_to_reg(data, nr, val);
-	data->write(data, index == 1 ? IT87_REG_VIN_MIN(nr)
-			: IT87_REG_VIN_MAX(nr),
-			data->in[nr][index]);
+	data->beeps = data->read(data, IT87_REG_BEEP_ENABLE);
+	if (val)
+		data->beeps |= BIT(bitnr);
+	else
+		data->beeps &= ~BIT(bitnr);
+	data->write(data, IT87_REG_BEEP_ENABLE, data->beeps);
 	it87_unlock(data);
-	return count;
+	return 0;
 }
 
-static SENSOR_DEVICE_ATTR_2(in0_input, S_IRUGO, show_in, NULL, 0, 0);
-static SENSOR_DEVICE_ATTR_2(in0_min, S_IRUGO | S_IWUSR, show_in, set_in,
-			    0, 1);
-static SENSOR_DEVICE_ATTR_2(in0_max, S_IRUGO | S_IWUSR, show_in, set_in,
-			    0, 2);
-
-static SENSOR_DEVICE_ATTR_2(in1_input, S_IRUGO, show_in, NULL, 1, 0);
-static SENSOR_DEVICE_ATTR_2(in1_min, S_IRUGO | S_IWUSR, show_in, set_in,
-			    1, 1);
-static SENSOR_DEVICE_ATTR_2(in1_max, S_IRUGO | S_IWUSR, show_in, set_in,
-			    1, 2);
-
-static SENSOR_DEVICE_ATTR_2(in2_input, S_IRUGO, show_in, NULL, 2, 0);
-static SENSOR_DEVICE_ATTR_2(in2_min, S_IRUGO | S_IWUSR, show_in, set_in,
-			    2, 1);
-static SENSOR_DEVICE_ATTR_2(in2_max, S_IRUGO | S_IWUSR, show_in, set_in,
-			    2, 2);
-
-static SENSOR_DEVICE_ATTR_2(in3_input, S_IRUGO, show_in, NULL, 3, 0);
-static SENSOR_DEVICE_ATTR_2(in3_min, S_IRUGO | S_IWUSR, show_in, set_in,
-			    3, 1);
-static SENSOR_DEVICE_ATTR_2(in3_max, S_IRUGO | S_IWUSR, show_in, set_in,
-			    3, 2);
-
-static SENSOR_DEVICE_ATTR_2(in4_input, S_IRUGO, show_in, NULL, 4, 0);
-static SENSOR_DEVICE_ATTR_2(in4_min, S_IRUGO | S_IWUSR, show_in, set_in,
-			    4, 1);
-static SENSOR_DEVICE_ATTR_2(in4_max, S_IRUGO | S_IWUSR, show_in, set_in,
-			    4, 2);
-
-static SENSOR_DEVICE_ATTR_2(in5_input, S_IRUGO, show_in, NULL, 5, 0);
-static SENSOR_DEVICE_ATTR_2(in5_min, S_IRUGO | S_IWUSR, show_in, set_in,
-			    5, 1);
-static SENSOR_DEVICE_ATTR_2(in5_max, S_IRUGO | S_IWUSR, show_in, set_in,
-			    5, 2);
-
-static SENSOR_DEVICE_ATTR_2(in6_input, S_IRUGO, show_in, NULL, 6, 0);
-static SENSOR_DEVICE_ATTR_2(in6_min, S_IRUGO | S_IWUSR, show_in, set_in,
-			    6, 1);
-static SENSOR_DEVICE_ATTR_2(in6_max, S_IRUGO | S_IWUSR, show_in, set_in,
-			    6, 2);
-
-static SENSOR_DEVICE_ATTR_2(in7_input, S_IRUGO, show_in, NULL, 7, 0);
-static SENSOR_DEVICE_ATTR_2(in7_min, S_IRUGO | S_IWUSR, show_in, set_in,
-			    7, 1);
-static SENSOR_DEVICE_ATTR_2(in7_max, S_IRUGO | S_IWUSR, show_in, set_in,
-			    7, 2);
-
-static SENSOR_DEVICE_ATTR_2(in8_input, S_IRUGO, show_in, NULL, 8, 0);
-static SENSOR_DEVICE_ATTR_2(in9_input, S_IRUGO, show_in, NULL, 9, 0);
-static SENSOR_DEVICE_ATTR_2(in10_input, S_IRUGO, show_in, NULL, 10, 0);
-static SENSOR_DEVICE_ATTR_2(in11_input, S_IRUGO, show_in, NULL, 11, 0);
-static SENSOR_DEVICE_ATTR_2(in12_input, S_IRUGO, show_in, NULL, 12, 0);
-
-/* Up to 6 temperatures */
-static ssize_t show_temp(struct device *dev, struct device_attribute *attr,
-			 char *buf)
+static int it87_read_in(struct device *dev, u32 attr, int channel, long *val)
 {
-	struct sensor_device_attribute_2 *sattr = to_sensor_dev_attr_2(attr);
-	int nr = sattr->nr;
-	int index = sattr->index;
-	struct it87_data *data = it87_update_device(dev);
+	struct it87_data *data = dev_get_drvdata(dev);
+	struct it87_sample s;
+	int index;
+
+	switch (attr) {
+	case hwmon_in_input:
+		if (it87_get_sample(data, &s)) {
+			*val = in_from_reg(data, channel, s.in[channel]);
+			return 0;
+		}
+		index = 0;
+		break;
+	case hwmon_in_min:
+		index = 1;
+		break;
+	case hwmon_in_max:
+		index = 2;
+		break;
+	case hwmon_in_alarm:
+		return it87_read_alarm(dev, 8 + channel, val);
+	case hwmon_in_beep:
+		return it87_read_beep(dev, 1, val);
+	default:
+		return -EOPNOTSUPP;
+	}
 
+	data = it87_update_device(dev, BIT_ULL(IT87_SLICE_IN(channel)));
 	if (IS_ERR(data))
 		return PTR_ERR(data);
 
-	return sprintf(buf, "%d\n", TEMP_FROM_REG(data->temp[nr][index]));
+	*val = in_from_reg(data, channel, data->in[channel][index]);
+	return 0;
 }
 
-static ssize_t set_temp(struct device *dev, struct device_attribute *attr,
-			const char *buf, size_t count)
+static int it87_write_in(struct device *dev, u32 attr, int channel, long val)
 {
-	struct sensor_device_attribute_2 *sattr = to_sensor_dev_attr_2(attr);
-	int nr = sattr->nr;
-	int index = sattr->index;
 	struct it87_data *data = dev_get_drvdata(dev);
-	long val;
-	u8 reg, regval;
+	int index;
 	int err;
 
-	if (kstrtol(buf, 10, &val) < 0)
+	switch (attr) {
+	case hwmon_in_min:
+		index = 1;
+		break;
+	case hwmon_in_max:
+		index = 2;
+		break;
+	case hwmon_in_beep:
+		return it87_write_beep(dev, 1, val);
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	if (val < 0)
 		return -EINVAL;
 
 	err = it87_lock(data);
 	if (err)
 		return err;
 
-	switch (index) {
-	default:
-	case 1:
-		reg = data->REG_TEMP_LOW[nr];
-		break;
-	case 2:
-		reg = data->REG_TEMP_HIGH[nr];
-		break;
-	case 3:
-		regval = data->read(data, IT87_REG_BEEP_ENABLE);
-		if (!(regval & 0x80)) {
-			regval |= 0x80;
-			data->write(data, IT87_REG_BEEP_ENABLE, regval);
-		}
-		data->valid = false;
-		reg = data->REG_TEMP_OFFSET[nr];
-		break;
-	}
-
-	data->temp[nr][index] = TEMP_TO_REG(val);
-	data->write(data, reg, data->temp[nr][index]);
+	data->in[channel][index] = in_to_reg(data, channel, val);
+	data->write(data, index == 1 ? IT87_REG_VIN_MIN(channel)
+			: IT87_REG_VIN_MAX(channel),
+			data->in[channel][index]);
 	it87_unlock(data);
-	return count;
+	return 0;
 }
 
-static SENSOR_DEVICE_ATTR_2(temp1_input, S_IRUGO, show_temp, NULL, 0, 0);
-static SENSOR_DEVICE_ATTR_2(temp1_min, S_IRUGO | S_IWUSR, show_temp, set_temp,
-			    0, 1);
-static SENSOR_DEVICE_ATTR_2(temp1_max, S_IRUGO | S_IWUSR, show_temp, set_temp,
-			    0, 2);
-static SENSOR_DEVICE_ATTR_2(temp1_offset, S_IRUGO | S_IWUSR, show_temp,
-			    set_temp, 0, 3);
-static SENSOR_DEVICE_ATTR_2(temp2_input, S_IRUGO, show_temp, NULL, 1, 0);
-static SENSOR_DEVICE_ATTR_2(temp2_min, S_IRUGO | S_IWUSR, show_temp, set_temp,
-			    1, 1);
-static SENSOR_DEVICE_ATTR_2(temp2_max, S_IRUGO | S_IWUSR, show_temp, set_temp,
-			    1, 2);
-static SENSOR_DEVICE_ATTR_2(temp2_offset, S_IRUGO | S_IWUSR, show_temp,
-			    set_temp, 1, 3);
-static SENSOR_DEVICE_ATTR_2(temp3_input, S_IRUGO, show_temp, NULL, 2, 0);
-static SENSOR_DEVICE_ATTR_2(temp3_min, S_IRUGO | S_IWUSR, show_temp, set_temp,
-			    2, 1);
-static SENSOR_DEVICE_ATTR_2(temp3_max, S_IRUGO | S_IWUSR, show_temp, set_temp,
-			    2, 2);
-static SENSOR_DEVICE_ATTR_2(temp3_offset, S_IRUGO | S_IWUSR, show_temp,
-			    set_temp, 2, 3);
-static SENSOR_DEVICE_ATTR_2(temp4_input, S_IRUGO, show_temp, NULL, 3, 0);
-static SENSOR_DEVICE_ATTR_2(temp4_min, S_IRUGO | S_IWUSR, show_temp, set_temp,
-			    3, 1);
-static SENSOR_DEVICE_ATTR_2(temp4_max, S_IRUGO | S_IWUSR, show_temp, set_temp,
-			    3, 2);
-static SENSOR_DEVICE_ATTR_2(temp4_offset, S_IRUGO | S_IWUSR, show_temp,
-			    set_temp, 3, 3);
-static SENSOR_DEVICE_ATTR_2(temp5_input, S_IRUGO, show_temp, NULL, 4, 0);
-static SENSOR_DEVICE_ATTR_2(temp5_min, S_IRUGO | S_IWUSR, show_temp, set_temp,
-			    4, 1);
-static SENSOR_DEVICE_ATTR_2(temp5_max, S_IRUGO | S_IWUSR, show_temp, set_temp,
-			    4, 2);
-static SENSOR_DEVICE_ATTR_2(temp5_offset, S_IRUGO | S_IWUSR, show_temp,
-			    set_temp, 4, 3);
-static SENSOR_DEVICE_ATTR_2(temp6_input, S_IRUGO, show_temp, NULL, 5, 0);
-static SENSOR_DEVICE_ATTR_2(temp6_min, S_IRUGO | S_IWUSR, show_temp, set_temp,
-			    5, 1);
-static SENSOR_DEVICE_ATTR_2(temp6_max, S_IRUGO | S_IWUSR, show_temp, set_temp,
-			    5, 2);
-static SENSOR_DEVICE_ATTR_2(temp6_offset, S_IRUGO | S_IWUSR, show_temp,
-			    set_temp, 5, 3);
-
+/* Up to 6 temperatures */
 static const u8 temp_types_8686[NUM_TEMP][9] = {
 	{ 0, 8, 8, 8, 8, 8, 8, 8, 7 },
 	{ 0, 6, 8, 8, 6, 0, 0, 0, 7 },
@@ -1620,34 +2012,12 @@ static int get_temp_type(struct it87_data *data, int index)
 	return type;
 }
 
-static ssize_t show_temp_type(struct device *dev, struct device_attribute *attr,
-			      char *buf)
+static int it87_write_temp_type(struct device *dev, int nr, long val)
 {
-	struct sensor_device_attribute *sensor_attr = to_sensor_dev_attr(attr);
-	struct it87_data *data = it87_update_device(dev);
-	int type;
-
-	if (IS_ERR(data))
-		return PTR_ERR(data);
-
-	type = get_temp_type(data, sensor_attr->index);
-	return sprintf(buf, "%d\n", type);
-}
-
-static ssize_t set_temp_type(struct device *dev, struct device_attribute *attr,
-			     const char *buf, size_t count)
-{
-	struct sensor_device_attribute *sensor_attr = to_sensor_dev_attr(attr);
-	int nr = sensor_attr->index;
-
 	struct it87_data *data = dev_get_drvdata(dev);
-	long val;
 	u8 reg, extra;
 	int err;
 
-	if (kstrtol(buf, 10, &val) < 0)
-		return -EINVAL;
-
 	err = it87_lock(data);
 	if (err)
 		return err;
@@ -1675,7 +2045,7 @@ static ssize_t set_temp_type(struct device *dev, struct device_attribute *attr,
 	else if (has_temp_old_peci(data, nr) && val == 6)
 		extra |= 0x80;
 	else if (val != 0) {
-		count = -EINVAL;
+		err = -EINVAL;
 		goto unlock;
 	}
 
@@ -1684,146 +2054,190 @@ static ssize_t set_temp_type(struct device *dev, struct device_attribute *attr,
 	data->write(data, IT87_REG_TEMP_ENABLE, data->sensor);
 	if (has_temp_old_peci(data, nr))
 		data->write(data, IT87_REG_TEMP_EXTRA, data->extra);
-	data->valid = false;  /* Force cache refresh */
+	it87_invalidate(data);  /* Force cache refresh */
 unlock:
 	it87_unlock(data);
-	return count;
+	return err;
 }
 
-static SENSOR_DEVICE_ATTR(temp1_type, S_IRUGO | S_IWUSR, show_temp_type,
-			  set_temp_type, 0);
-static SENSOR_DEVICE_ATTR(temp2_type, S_IRUGO | S_IWUSR, show_temp_type,
-			  set_temp_type, 1);
-static SENSOR_DEVICE_ATTR(temp3_type, S_IRUGO | S_IWUSR, show_temp_type,
-			  set_temp_type, 2);
-static SENSOR_DEVICE_ATTR(temp4_type, S_IRUGO | S_IWUSR, show_temp_type,
-			  set_temp_type, 3);
-static SENSOR_DEVICE_ATTR(temp5_type, S_IRUGO | S_IWUSR, show_temp_type,
-			  set_temp_type, 4);
-static SENSOR_DEVICE_ATTR(temp6_type, S_IRUGO | S_IWUSR, show_temp_type,
-			  set_temp_type, 5);
-
-/* 6 Fans */
-
-static int pwm_mode(const struct it87_data *data, int nr)
+static int it87_read_temp(struct device *dev, u32 attr, int channel,
+			  long *val)
 {
-	if (has_fanctl_onoff(data) && nr < 3 && !(data->fan_main_ctrl & BIT(nr)))
-		return 0;				/* Full speed */
-	if (data->pwm_ctrl[nr] & 0x80)
-		return 2;				/* Automatic mode */
-	if ((!has_fanctl_onoff(data) || nr >= 3) &&
-	    data->pwm_duty[nr] == pwm_to_reg(data, 0xff))
-		return 0;			/* Full speed */
-
-	return 1;				/* Manual mode */
-}
+	struct it87_data *data = dev_get_drvdata(dev);
+	struct it87_sample s;
+	int index;
+	int err;
 
-static ssize_t show_fan(struct device *dev, struct device_attribute *attr,
-			char *buf)
-{
-	struct sensor_device_attribute_2 *sattr = to_sensor_dev_attr_2(attr);
-	int nr = sattr->nr;
-	int index = sattr->index;
-	int speed;
-	struct it87_data *data = it87_update_device(dev);
+	switch (attr) {
+	case hwmon_temp_input:
+		if (it87_get_sample(data, &s)) {
+			*val = TEMP_FROM_REG(s.temp[channel]);
+			return 0;
+		}
+		index = 0;
+		break;
+	case hwmon_temp_min:
+		index = 1;
+		break;
+	case hwmon_temp_max:
+		index = 2;
+		break;
+	case hwmon_temp_offset:
+		index = 3;
+		break;
+	case hwmon_temp_type:
+		data = it87_update_device(dev, BIT_ULL(IT87_SLICE_CTRL));
+		if (IS_ERR(data))
+			return PTR_ERR(data);
+		/* get_temp_type() reads registers, possibly in another bank */
+		err = it87_lock(data);
+		if (err)
+			return err;
+		*val = get_temp_type(data, channel);
+		it87_unlock(data);
+		return 0;
+	case hwmon_temp_alarm:
+		return it87_read_alarm(dev, 16 + channel, val);
+	case hwmon_temp_beep:
+		return it87_read_beep(dev, 2, val);
+	default:
+		return -EOPNOTSUPP;
+	}
 
+	data = it87_update_device(dev, BIT_ULL(IT87_SLICE_TEMP(channel)));
 	if (IS_ERR(data))
 		return PTR_ERR(data);
 
-	speed = has_16bit_fans(data) ?
-		FAN16_FROM_REG(data->fan[nr][index]) :
-		FAN_FROM_REG(data->fan[nr][index],
-			     DIV_FROM_REG(data->fan_div[nr]));
-	return sprintf(buf, "%d\n", speed);
+	*val = TEMP_FROM_REG(data->temp[channel][index]);
+	return 0;
 }
 
-static ssize_t show_fan_div(struct device *dev, struct device_attribute *attr,
-			    char *buf)
+static int it87_write_temp(struct device *dev, u32 attr, int channel,
+			   long val)
 {
-	struct sensor_device_attribute *sensor_attr = to_sensor_dev_attr(attr);
-	struct it87_data *data = it87_update_device(dev);
-	int nr = sensor_attr->index;
-
-	if (IS_ERR(data))
-		return PTR_ERR(data);
+	struct it87_data *data = dev_get_drvdata(dev);
+	u8 reg, regval;
+	int index;
+	int err;
 
-	return sprintf(buf, "%lu\n", DIV_FROM_REG(data->fan_div[nr]));
-}
+	switch (attr) {
+	case hwmon_temp_min:
+		index = 1;
+		reg = data->REG_TEMP_LOW[channel];
+		break;
+	case hwmon_temp_max:
+		index = 2;
+		reg = data->REG_TEMP_HIGH[channel];
+		break;
+	case hwmon_temp_offset:
+		index = 3;
+		reg = data->REG_TEMP_OFFSET[channel];
+		break;
+	case hwmon_temp_type:
+		return it87_write_temp_type(dev, channel, val);
+	case hwmon_temp_beep:
+		return it87_write_beep(dev, 2, val);
+	default:
+		return -EOPNOTSUPP;
+	}
 
-static ssize_t show_pwm_enable(struct device *dev,
-			       struct device_attribute *attr, char *buf)
-{
-	struct sensor_device_attribute *sensor_attr = to_sensor_dev_attr(attr);
-	struct it87_data *data = it87_update_device(dev);
-	int nr = sensor_attr->index;
+	err = it87_lock(data);
+	if (err)
+		return err;
 
-	if (IS_ERR(data))
-		return PTR_ERR(data);
+	if (index == 3) {
+		regval = data->read(data, IT87_REG_BEEP_ENABLE);
+		if (!(regval & 0x80)) {
+			regval |= 0x80;
+			data->write(data, IT87_REG_BEEP_ENABLE, regval);
+		}
+		it87_invalidate(data);
+	}
 
-	return sprintf(buf, "%d\n", pwm_mode(data, nr));
+	data->temp[channel][index] = TEMP_TO_REG(val);
+	data->write(data, reg, data->temp[channel][index]);
+	it87_unlock(data);
+	return 0;
 }
 
-static ssize_t show_pwm(struct device *dev, struct device_attribute *attr,
-			char *buf)
-{
-	struct sensor_device_attribute *sensor_attr = to_sensor_dev_attr(attr);
-	struct it87_data *data = it87_update_device(dev);
-	int nr = sensor_attr->index;
+/* 6 Fans */
 
-	if (IS_ERR(data))
-		return PTR_ERR(data);
+static int pwm_mode(const struct it87_data *data, int nr)
+{
+	if (has_fanctl_onoff(data) && nr < 3 && !(data->fan_main_ctrl & BIT(nr)))
+		return 0;				/* Full speed */
+	if (data->pwm_ctrl[nr] & 0x80)
+		return 2;				/* Automatic mode */
+	if ((!has_fanctl_onoff(data) || nr >= 3) &&
+	    data->pwm_duty[nr] == pwm_to_reg(data, 0xff))
+		return 0;			/* Full speed */
 
-	return sprintf(buf, "%d\n",
-		       pwm_from_reg(data, data->pwm_duty[nr]));
+	return 1;				/* Manual mode */
 }
 
-static ssize_t show_pwm_freq(struct device *dev, struct device_attribute *attr,
-			     char *buf)
+static int it87_read_fan(struct device *dev, u32 attr, int channel, long *val)
 {
-	struct sensor_device_attribute *sensor_attr = to_sensor_dev_attr(attr);
-	struct it87_data *data = it87_update_device(dev);
-	int nr = sensor_attr->index;
-	unsigned int freq;
+	static const u8 alarm_bits[] = { 0, 1, 2, 3, 6, 7 };
+	struct it87_data *data = dev_get_drvdata(dev);
+	struct it87_sample s;
 	int index;
 
+	switch (attr) {
+	case hwmon_fan_input:
+		if (it87_get_sample(data, &s)) {
+			*val = has_16bit_fans(data) ?
+				FAN16_FROM_REG(s.fan[channel]) :
+				FAN_FROM_REG(s.fan[channel],
+					     DIV_FROM_REG(s.fan_div[channel]));
+			return 0;
+		}
+		index = 0;
+		break;
+	case hwmon_fan_min:
+		index = 1;
+		break;
+	case hwmon_fan_div:
+		data = it87_update_device(dev, BIT_ULL(IT87_SLICE_CTRL));
+		if (IS_ERR(data))
+			return PTR_ERR(data);
+		*val = DIV_FROM_REG(data->fan_div[channel]);
+		return 0;
+	case hwmon_fan_alarm:
+		return it87_read_alarm(dev, alarm_bits[channel], val);
+	case hwmon_fan_beep:
+		return it87_read_beep(dev, 0, val);
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	data = it87_update_device(dev, BIT_ULL(IT87_SLICE_FAN(channel)) |
+					 BIT_ULL(IT87_SLICE_CTRL));
 	if (IS_ERR(data))
 		return PTR_ERR(data);
 
-	if (has_pwm_freq2(data) && nr == 1)
-		index = (data->extra >> 4) & 0x07;
-	else
-		index = (data->fan_ctl >> 4) & 0x07;
-
-	freq = pwm_freq[index] / (has_newer_autopwm(data) ? 256 : 128);
-
-	return sprintf(buf, "%u\n", freq);
+	*val = has_16bit_fans(data) ?
+		FAN16_FROM_REG(data->fan[channel][index]) :
+		FAN_FROM_REG(data->fan[channel][index],
+			     DIV_FROM_REG(data->fan_div[channel]));
+	return 0;
 }
 
-static ssize_t set_fan(struct device *dev, struct device_attribute *attr,
-		       const char *buf, size_t count)
+static int it87_write_fan_min(struct device *dev, int nr, long val)
 {
-	struct sensor_device_attribute_2 *sattr = to_sensor_dev_attr_2(attr);
-	int nr = sattr->nr;
-	int index = sattr->index;
-
 	struct it87_data *data = dev_get_drvdata(dev);
-	long val;
 	int err;
 	u8 reg;
 
-	if (kstrtol(buf, 10, &val) < 0)
-		return -EINVAL;
-
 	err = it87_lock(data);
 	if (err)
 		return err;
 
 	if (has_16bit_fans(data)) {
-		data->fan[nr][index] = FAN16_TO_REG(val);
+		data->fan[nr][1] = FAN16_TO_REG(val);
 		data->write(data, data->REG_FAN_MIN[nr],
-				 data->fan[nr][index] & 0xff);
+				 data->fan[nr][1] & 0xff);
 		data->write(data, data->REG_FANX_MIN[nr],
-				 data->fan[nr][index] >> 8);
+				 data->fan[nr][1] >> 8);
 	} else {
 		reg = data->read(data, IT87_REG_FAN_DIV);
 		switch (nr) {
@@ -1837,25 +2251,21 @@ static ssize_t set_fan(struct device *dev, struct device_attribute *attr,
 			data->fan_div[nr] = (reg & 0x40) ? 3 : 1;
 			break;
 		}
-		data->fan[nr][index] =
+		data->fan[nr][1] =
 		  FAN_TO_REG(val, DIV_FROM_REG(data->fan_div[nr]));
-		data->write(data, data->REG_FAN_MIN[nr], data->fan[nr][index]);
+		data->write(data, data->REG_FAN_MIN[nr], data->fan[nr][1]);
 	}
 	it87_unlock(data);
-	return count;
+	return 0;
 }
 
-static ssize_t set_fan_div(struct device *dev, struct device_attribute *attr,
-			   const char *buf, size_t count)
+static int it87_write_fan_div(struct device *dev, int nr, long val)
 {
-	struct sensor_device_attribute *sensor_attr = to_sensor_dev_attr(attr);
 	struct it87_data *data = dev_get_drvdata(dev);
-	int nr = sensor_attr->index;
-	unsigned long val;
 	int min, err;
 	u8 old;
 
-	if (kstrtoul(buf, 10, &val) < 0)
+	if (val < 0)
 		return -EINVAL;
 
 	err = it87_lock(data);
@@ -1889,7 +2299,21 @@ static ssize_t set_fan_div(struct device *dev, struct device_attribute *attr,
 	data->fan[nr][1] = FAN_TO_REG(min, DIV_FROM_REG(data->fan_div[nr]));
 	data->write(data, data->REG_FAN_MIN[nr], data->fan[nr][1]);
 	it87_unlock(data);
-	return count;
+	return 0;
+}
+
+static int it87_write_fan(struct device *dev, u32 attr, int channel, long val)
+{
+	switch (attr) {
+	case hwmon_fan_min:
+		return it87_write_fan_min(dev, channel, val);
+	case hwmon_fan_div:
+		return it87_write_fan_div(dev, channel, val);
+	case hwmon_fan_beep:
+		return it87_write_beep(dev, 0, val);
+	default:
+		return -EOPNOTSUPP;
+	}
 }
 
 /* Returns 0 if OK, -EINVAL otherwise */
@@ -1922,18 +2346,320 @@ static int check_trip_points(struct device *dev, int nr)
 	return err;
 }
 
-static ssize_t set_pwm_enable(struct device *dev, struct device_attribute *attr,
-			      const char *buf, size_t count)
+static int it87_read_pwm(struct device *dev, u32 attr, int channel, long *val)
+{
+	struct it87_data *data;
+	int index;
+
+	switch (attr) {
+	case hwmon_pwm_enable:
+		data = it87_update_device(dev,
+					  BIT_ULL(IT87_SLICE_PWM(channel)) |
+					  BIT_ULL(IT87_SLICE_CTRL));
+		if (IS_ERR(data))
+			return PTR_ERR(data);
+		if (data->fan_loop_mask & BIT(channel))
+			*val = 3;
+		else
+			*val = pwm_mode(data, channel);
+		return 0;
+	case hwmon_pwm_input:
+		data = it87_update_device(dev,
+					  BIT_ULL(IT87_SLICE_PWM(channel)));
+		if (IS_ERR(data))
+			return PTR_ERR(data);
+		*val = pwm_from_reg(data, data->pwm_duty[channel]);
+		return 0;
+	case hwmon_pwm_freq:
+		data = it87_update_device(dev, BIT_ULL(IT87_SLICE_CTRL));
+		if (IS_ERR(data))
+			return PTR_ERR(data);
+		if (has_pwm_freq2(data) && channel == 1)
+			index = (data->extra >> 4) & 0x07;
+		else
+			index = (data->fan_ctl >> 4) & 0x07;
+		*val = pwm_freq[index] / (has_newer_autopwm(data) ? 256 : 128);
+		return 0;
+	case hwmon_pwm_auto_channels_temp:
+		data = it87_update_device(dev,
+					  BIT_ULL(IT87_SLICE_PWM(channel)));
+		if (IS_ERR(data))
+			return PTR_ERR(data);
+		*val = data->pwm_temp_map[channel] + 1;
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+/* Temperature channel feeding the fan control loop, or -1 if unusable */
+static int it87_fan_loop_channel(const struct it87_data *data, int nr)
+{
+	int t = data->pwm_temp_map[nr];
+
+	if (t >= NUM_TEMP || !(data->has_temp & BIT(t)))
+		return -1;
+	return t;
+}
+
+/*
+ * Write a manual duty cycle. Must be called with data->update_lock held,
+ * SMBus accesses disabled and the output in manual mode.
+ */
+static void it87_fan_loop_write(struct it87_data *data, int nr, int val)
+{
+	data->pwm_duty[nr] = pwm_to_reg(data, val);
+	if (has_newer_autopwm(data)) {
+		data->write(data, IT87_REG_PWM_DUTY[nr], data->pwm_duty[nr]);
+	} else {
+		data->pwm_ctrl[nr] = data->pwm_duty[nr];
+		data->write(data, data->REG_PWM[nr], data->pwm_ctrl[nr]);
+	}
+}
+
+/* One PI controller iteration over @period ms, with data->update_lock held */
+static void it87_fan_loop_step(struct it87_data *data, int nr, long temp,
+			       unsigned int period)
+{
+	struct it87_fan_loop *loop = &data->fan_loop[nr];
+	long error = temp - loop->target;
+	s64 integral;
+	int out;
+
+	/* Clamping the integral to the output range avoids windup */
+	integral = loop->integral +
+		   div_s64((s64)error * fan_loop_ki * period, 1000);
+	loop->integral = clamp_t(s64, integral, loop->min * 1000,
+				 loop->max * 1000);
+
+	out = loop->integral / 1000 + error * (long)fan_loop_kp / 1000;
+	out = clamp_t(int, out, loop->min, loop->max);
+	if (loop->step)
+		out = clamp_t(int, out, loop->out - loop->step,
+			      loop->out + loop->step);
+
+	/* Only touch the chip when the output changes */
+	if (out == loop->out)
+		return;
+	loop->out = out;
+	it87_fan_loop_write(data, nr, out);
+}
+
+static void it87_fan_loop_work(struct work_struct *work)
+{
+	struct it87_data *data = container_of(to_delayed_work(work),
+					      struct it87_data, fan_loop_work);
+	unsigned long mask = READ_ONCE(data->fan_loop_mask);
+	unsigned int period;
+	long temp[NUM_PWM];
+	int nr, t;
+
+	/* The integral term must use the period the loop runs at */
+	period = max_t(unsigned int, READ_ONCE(fan_loop_interval),
+		       IT87_FAN_LOOP_MIN_MS);
+
+	/* Cached or sampled readings, outside of the register lock */
+	for_each_set_bit(nr, &mask, NUM_PWM) {
+		t = it87_fan_loop_channel(data, nr);
+		if (t < 0 || it87_read_temp(data->dev, hwmon_temp_input, t,
+					    &temp[nr]))
+			__clear_bit(nr, &mask);
+	}
+
+	if (mask && !it87_lock(data)) {
+		for_each_set_bit(nr, &mask, NUM_PWM) {
+			if (data->fan_loop_mask & BIT(nr))
+				it87_fan_loop_step(data, nr, temp[nr], period);
+		}
+		it87_unlock(data);
+	}
+
+	if (READ_ONCE(data->fan_loop_mask))
+		schedule_delayed_work(&data->fan_loop_work,
+				      msecs_to_jiffies(period));
+}
+
+/* Leave the fans at full speed rather than at the last loop output */
+static void it87_stop_fan_loop(void *arg)
+{
+	struct it87_data *data = arg;
+	unsigned long mask;
+	int nr;
+
+	mutex_lock(&data->update_lock);
+	mask = data->fan_loop_mask;
+	data->fan_loop_mask = 0;
+	mutex_unlock(&data->update_lock);
+	cancel_delayed_work_sync(&data->fan_loop_work);
+
+	if (!mask || it87_lock(data))
+		return;
+	for_each_set_bit(nr, &mask, NUM_PWM)
+		it87_fan_loop_write(data, nr, 0xff);
+	it87_unlock(data);
+}
+
+/* Defaults for all outputs, the loop only starts with pwmN_enable=3 */
+static int it87_init_fan_loop(struct device *dev, struct it87_data *data)
+{
+	struct it87_fan_loop *loop;
+	int nr;
+
+	for (nr = 0; nr < NUM_PWM; nr++) {
+		loop = &data->fan_loop[nr];
+		loop->target = IT87_FAN_LOOP_TARGET;
+		loop->min = IT87_FAN_LOOP_MIN;
+		loop->max = IT87_FAN_LOOP_MAX;
+		loop->step = IT87_FAN_LOOP_STEP;
+	}
+	INIT_DELAYED_WORK(&data->fan_loop_work, it87_fan_loop_work);
+
+	return devm_add_action_or_reset(dev, it87_stop_fan_loop, data);
+}
+
+/*
+ * Switch to manual (1) or automatic (2) mode.
+ * Must be called with it87_lock() held.
+ */
+static void it87_write_pwm_ctrl_mode(struct it87_data *data, int nr, int val)
+{
+	u8 ctrl;
+
+	if (has_newer_autopwm(data)) {
+		ctrl = temp_map_to_reg(data, nr,
+			data->pwm_temp_map[nr]);
+		if (val == 1)
+			ctrl &= 0x7f;
+		else
+			ctrl |= 0x80;
+	} else {
+		ctrl = (val == 1 ? data->pwm_duty[nr] : 0x80);
+	}
+	data->pwm_ctrl[nr] = ctrl;
+	data->write(data, data->REG_PWM[nr], ctrl);
+
+	if (has_fanctl_onoff(data) && nr < 3) {
+		/* set SmartGuardian mode */
+		data->fan_main_ctrl |= BIT(nr);
+		data->write(data, IT87_REG_FAN_MAIN_CTRL,
+				 data->fan_main_ctrl);
+	}
+}
+
+/* Duty cycle of each cooling state, state 0 still keeps the fan spinning */
+static const u8 it87_cooling_duty[] = {
+	IT87_FAN_LOOP_MIN, 80, 96, 128, 160, 192, 224, 255
+};
+
+static int it87_cooling_get_max_state(struct thermal_cooling_device *cdev,
+				      unsigned long *state)
+{
+	*state = ARRAY_SIZE(it87_cooling_duty) - 1;
+	return 0;
+}
+
+static int it87_cooling_get_cur_state(struct thermal_cooling_device *cdev,
+				      unsigned long *state)
+{
+	struct it87_cooling *cooling = cdev->devdata;
+	struct it87_data *data;
+	int duty;
+
+	data = it87_update_device(cooling->data->dev,
+				  BIT_ULL(IT87_SLICE_PWM(cooling->nr)));
+	if (IS_ERR(data))
+		return PTR_ERR(data);
+
+	/* The lowest state running the fan at least as fast */
+	duty = pwm_from_reg(data, data->pwm_duty[cooling->nr]);
+	for (*state = 0; *state < ARRAY_SIZE(it87_cooling_duty) - 1;
+	     (*state)++) {
+		if (it87_cooling_duty[*state] >= duty)
+			break;
+	}
+	return 0;
+}
+
+/*
+ * The thermal framework only drives outputs left in manual mode, so that
+ * pwmN_enable keeps the last word on who controls the fan.
+ */
+static int it87_cooling_set_cur_state(struct thermal_cooling_device *cdev,
+				      unsigned long state)
+{
+	struct it87_cooling *cooling = cdev->devdata;
+	struct it87_data *data = cooling->data;
+	int nr = cooling->nr;
+	int err;
+
+	if (state >= ARRAY_SIZE(it87_cooling_duty))
+		return -EINVAL;
+
+	err = it87_lock(data);
+	if (err)
+		return err;
+
+	it87_update_pwm_ctrl(data, nr);
+	if (pwm_mode(data, nr) != 1 || (data->fan_loop_mask & BIT(nr)))
+		err = -EBUSY;
+	else
+		it87_fan_loop_write(data, nr, it87_cooling_duty[state]);
+	it87_unlock(data);
+	return err;
+}
+
+static const struct thermal_cooling_device_ops it87_cooling_ops = {
+	.get_max_state = it87_cooling_get_max_state,
+	.get_cur_state = it87_cooling_get_cur_state,
+	.set_cur_state = it87_cooling_set_cur_state,
+};
+
+static int it87_init_cooling(struct device *dev, struct it87_data *data)
+{
+	struct thermal_cooling_device *cdev;
+	struct it87_cooling *cooling;
+	const char *type;
+	int nr;
+
+	if (!IS_ENABLED(CONFIG_THERMAL))
+		return 0;
+
+	/* Only outputs with a tachometer drive a fan */
+	for (nr = 0; nr < NUM_PWM; nr++) {
+		if (!(data->has_pwm & data->has_fan & cooling_mask & BIT(nr)))
+			continue;
+
+		cooling = &data->cooling[nr];
+		cooling->data = data;
+		cooling->nr = nr;
+		type = devm_kasprintf(dev, GFP_KERNEL, "it87-pwm%d", nr + 1);
+		if (!type)
+			return -ENOMEM;
+
+		cdev = devm_thermal_of_cooling_device_register(dev, NULL,
+				type, cooling, &it87_cooling_ops);
+		if (IS_ERR(cdev)) {
+			dev_err(dev, "Failed to register %s\n", type);
+			return PTR_ERR(cdev);
+		}
+	}
+	return 0;
+}
+
+static int it87_write_pwm_enable(struct device *dev, int nr, long val)
 {
-	struct sensor_device_attribute *sensor_attr = to_sensor_dev_attr(attr);
 	struct it87_data *data = dev_get_drvdata(dev);
-	int nr = sensor_attr->index;
-	long val;
+	struct it87_fan_loop *loop = &data->fan_loop[nr];
+	bool run_loop = val == 3;
 	int err;
 
-	if (kstrtol(buf, 10, &val) < 0 || val < 0 || val > 2)
+	if (val < 0 || val > 3)
 		return -EINVAL;
 
+	/* The control loop drives the output in manual mode */
+	if (run_loop)
+		val = 1;
+
 	/* Check trip points before switching to automatic mode */
 	if (val == 2) {
 		if (check_trip_points(dev, nr) < 0)
@@ -1946,6 +2672,12 @@ static ssize_t set_pwm_enable(struct device *dev, struct device_attribute *attr,
 
 	it87_update_pwm_ctrl(data, nr);
 
+	/* The temperature mapping was just refreshed from the chip */
+	if (run_loop && it87_fan_loop_channel(data, nr) < 0) {
+		it87_unlock(data);
+		return -EINVAL;
+	}
+
 	if (val == 0) {
 		if (nr < 3 && has_fanctl_onoff(data)) {
 			int tmp;
@@ -1975,48 +2707,43 @@ static ssize_t set_pwm_enable(struct device *dev, struct device_attribute *attr,
 			data->write(data, data->REG_PWM[nr], ctrl);
 		}
 	} else {
-		u8 ctrl;
-
-		if (has_newer_autopwm(data)) {
-			ctrl = temp_map_to_reg(data, nr,
-				data->pwm_temp_map[nr]);
-			if (val == 1)
-				ctrl &= 0x7f;
-			else
-				ctrl |= 0x80;
-		} else {
-			ctrl = (val == 1 ? data->pwm_duty[nr] : 0x80);
-		}
-		data->pwm_ctrl[nr] = ctrl;
-		data->write(data, data->REG_PWM[nr], ctrl);
+		it87_write_pwm_ctrl_mode(data, nr, val);
+	}
 
-		if (has_fanctl_onoff(data) && nr < 3) {
-			/* set SmartGuardian mode */
-			data->fan_main_ctrl |= BIT(nr);
-			data->write(data, IT87_REG_FAN_MAIN_CTRL,
-					 data->fan_main_ctrl);
-		}
+	if (run_loop && !(data->fan_loop_mask & BIT(nr))) {
+		/* Start from the current duty cycle, without a jump */
+		loop->out = pwm_from_reg(data, data->pwm_duty[nr]);
+		loop->integral = clamp_t(int, loop->out, loop->min,
+					 loop->max) * 1000;
+		data->fan_loop_mask |= BIT(nr);
+	} else if (!run_loop) {
+		data->fan_loop_mask &= ~BIT(nr);
 	}
 	it87_unlock(data);
-	return count;
+
+	if (run_loop)
+		schedule_delayed_work(&data->fan_loop_work, 0);
+	return 0;
 }
 
-static ssize_t set_pwm(struct device *dev, struct device_attribute *attr,
-		       const char *buf, size_t count)
+static int it87_write_pwm_input(struct device *dev, int nr, long val)
 {
-	struct sensor_device_attribute *sensor_attr = to_sensor_dev_attr(attr);
 	struct it87_data *data = dev_get_drvdata(dev);
-	int nr = sensor_attr->index;
-	long val;
 	int err;
 
-	if (kstrtol(buf, 10, &val) < 0 || val < 0 || val > 255)
+	if (val < 0 || val > 255)
 		return -EINVAL;
 
 	err = it87_lock(data);
 	if (err)
 		return err;
 
+	/* The control loop owns the duty cycle */
+	if (data->fan_loop_mask & BIT(nr)) {
+		err = -EBUSY;
+		goto unlock;
+	}
+
 	it87_update_pwm_ctrl(data, nr);
 	if (has_newer_autopwm(data)) {
 		/*
@@ -2024,7 +2751,7 @@ static ssize_t set_pwm(struct device *dev, struct device_attribute *attr,
 		 * is read-only so we can't write the value.
 		 */
 		if (data->pwm_ctrl[nr] & 0x80) {
-			count = -EBUSY;
+			err = -EBUSY;
 			goto unlock;
 		}
 		data->pwm_duty[nr] = pwm_to_reg(data, val);
@@ -2044,20 +2771,16 @@ static ssize_t set_pwm(struct device *dev, struct device_attribute *attr,
 	}
 unlock:
 	it87_unlock(data);
-	return count;
+	return err;
 }
 
-static ssize_t set_pwm_freq(struct device *dev, struct device_attribute *attr,
-			    const char *buf, size_t count)
+static int it87_write_pwm_freq(struct device *dev, int nr, long val)
 {
-	struct sensor_device_attribute *sensor_attr = to_sensor_dev_attr(attr);
 	struct it87_data *data = dev_get_drvdata(dev);
-	int nr = sensor_attr->index;
-	unsigned long val;
 	int err;
 	int i;
 
-	if (kstrtoul(buf, 10, &val) < 0)
+	if (val < 0)
 		return -EINVAL;
 
 	val = clamp_val(val, 0, 1000000);
@@ -2081,39 +2804,18 @@ static ssize_t set_pwm_freq(struct device *dev, struct device_attribute *attr,
 		data->extra = data->read(data, IT87_REG_TEMP_EXTRA) & 0x8f;
 		data->extra |= i << 4;
 		data->write(data, IT87_REG_TEMP_EXTRA, data->extra);
-	}
-	it87_unlock(data);
-	return count;
-}
-
-static ssize_t show_pwm_temp_map(struct device *dev,
-				 struct device_attribute *attr, char *buf)
-{
-	struct sensor_device_attribute *sensor_attr = to_sensor_dev_attr(attr);
-	struct it87_data *data = it87_update_device(dev);
-	int nr = sensor_attr->index;
-
-	if (IS_ERR(data))
-		return PTR_ERR(data);
-
-	return sprintf(buf, "%d\n", data->pwm_temp_map[nr] + 1);
+	}
+	it87_unlock(data);
+	return 0;
 }
 
-static ssize_t set_pwm_temp_map(struct device *dev,
-				struct device_attribute *attr, const char *buf,
-				size_t count)
+static int it87_write_pwm_temp_map(struct device *dev, int nr, long val)
 {
-	struct sensor_device_attribute *sensor_attr = to_sensor_dev_attr(attr);
 	struct it87_data *data = dev_get_drvdata(dev);
-	int nr = sensor_attr->index;
-	unsigned long val;
 	int err;
 	u8 map;
 
-	if (kstrtoul(buf, 10, &val) < 0)
-		return -EINVAL;
-
-	if (!val || val > data->pwm_num_temp_map)
+	if (val < 1 || val > data->pwm_num_temp_map)
 		return -EINVAL;
 
 	map = val - 1;
@@ -2133,18 +2835,35 @@ static ssize_t set_pwm_temp_map(struct device *dev,
 		data->write(data, data->REG_PWM[nr], data->pwm_ctrl[nr]);
 	}
 	it87_unlock(data);
-	return count;
+	return 0;
+}
+
+static int it87_write_pwm(struct device *dev, u32 attr, int channel, long val)
+{
+	switch (attr) {
+	case hwmon_pwm_enable:
+		return it87_write_pwm_enable(dev, channel, val);
+	case hwmon_pwm_input:
+		return it87_write_pwm_input(dev, channel, val);
+	case hwmon_pwm_freq:
+		return it87_write_pwm_freq(dev, channel, val);
+	case hwmon_pwm_auto_channels_temp:
+		return it87_write_pwm_temp_map(dev, channel, val);
+	default:
+		return -EOPNOTSUPP;
+	}
 }
 
 static ssize_t show_auto_pwm(struct device *dev, struct device_attribute *attr,
 			     char *buf)
 {
-	struct it87_data *data = it87_update_device(dev);
+	struct it87_data *data;
 	struct sensor_device_attribute_2 *sensor_attr =
 			to_sensor_dev_attr_2(attr);
 	int nr = sensor_attr->nr;
 	int point = sensor_attr->index;
 
+	data = it87_update_device(dev, BIT_ULL(IT87_SLICE_PWM(nr)));
 	if (IS_ERR(data))
 		return PTR_ERR(data);
 
@@ -2152,6 +2871,20 @@ static ssize_t show_auto_pwm(struct device *dev, struct device_attribute *attr,
 		       pwm_from_reg(data, data->auto_pwm[nr][point]));
 }
 
+/* Must be called with it87_lock() held */
+static void it87_write_auto_pwm(struct it87_data *data, int nr, int point,
+				long val)
+{
+	int regaddr;
+
+	data->auto_pwm[nr][point] = pwm_to_reg(data, val);
+	if (has_newer_autopwm(data))
+		regaddr = IT87_REG_AUTO_TEMP(nr, 3);
+	else
+		regaddr = IT87_REG_AUTO_PWM(nr, point);
+	data->write(data, regaddr, data->auto_pwm[nr][point]);
+}
+
 static ssize_t set_auto_pwm(struct device *dev, struct device_attribute *attr,
 			    const char *buf, size_t count)
 {
@@ -2160,7 +2893,6 @@ static ssize_t set_auto_pwm(struct device *dev, struct device_attribute *attr,
 			to_sensor_dev_attr_2(attr);
 	int nr = sensor_attr->nr;
 	int point = sensor_attr->index;
-	int regaddr;
 	long val;
 	int err;
 
@@ -2171,12 +2903,7 @@ static ssize_t set_auto_pwm(struct device *dev, struct device_attribute *attr,
 	if (err)
 		return err;
 
-	data->auto_pwm[nr][point] = pwm_to_reg(data, val);
-	if (has_newer_autopwm(data))
-		regaddr = IT87_REG_AUTO_TEMP(nr, 3);
-	else
-		regaddr = IT87_REG_AUTO_PWM(nr, point);
-	data->write(data, regaddr, data->auto_pwm[nr][point]);
+	it87_write_auto_pwm(data, nr, point, val);
 	it87_unlock(data);
 	return count;
 }
@@ -2184,16 +2911,24 @@ static ssize_t set_auto_pwm(struct device *dev, struct device_attribute *attr,
 static ssize_t show_auto_pwm_slope(struct device *dev,
 				   struct device_attribute *attr, char *buf)
 {
-	struct it87_data *data = it87_update_device(dev);
+	struct it87_data *data;
 	struct sensor_device_attribute *sensor_attr = to_sensor_dev_attr(attr);
 	int nr = sensor_attr->index;
 
+	data = it87_update_device(dev, BIT_ULL(IT87_SLICE_PWM(nr)));
 	if (IS_ERR(data))
 		return PTR_ERR(data);
 
 	return sprintf(buf, "%d\n", data->auto_pwm[nr][1] & 0x7f);
 }
 
+/* Must be called with it87_lock() held */
+static void it87_write_auto_slope(struct it87_data *data, int nr, long val)
+{
+	data->auto_pwm[nr][1] = (data->auto_pwm[nr][1] & 0x80) | val;
+	data->write(data, IT87_REG_AUTO_TEMP(nr, 4), data->auto_pwm[nr][1]);
+}
+
 static ssize_t set_auto_pwm_slope(struct device *dev,
 				  struct device_attribute *attr,
 				  const char *buf, size_t count)
@@ -2211,31 +2946,58 @@ static ssize_t set_auto_pwm_slope(struct device *dev,
 	if (err)
 		return err;
 
-	data->auto_pwm[nr][1] = (data->auto_pwm[nr][1] & 0x80) | val;
-	data->write(data, IT87_REG_AUTO_TEMP(nr, 4), data->auto_pwm[nr][1]);
+	it87_write_auto_slope(data, nr, val);
 	it87_unlock(data);
 	return count;
 }
 
+static int it87_auto_temp_from_reg(const struct it87_data *data, int nr,
+				   int point)
+{
+	int reg;
+
+	if (has_old_autopwm(data) || point)
+		reg = data->auto_temp[nr][point];
+	else
+		reg = data->auto_temp[nr][1] - (data->auto_temp[nr][0] & 0x1f);
+
+	return TEMP_FROM_REG(reg);
+}
+
 static ssize_t show_auto_temp(struct device *dev, struct device_attribute *attr,
 			      char *buf)
 {
-	struct it87_data *data = it87_update_device(dev);
+	struct it87_data *data;
 	struct sensor_device_attribute_2 *sensor_attr =
 			to_sensor_dev_attr_2(attr);
 	int nr = sensor_attr->nr;
 	int point = sensor_attr->index;
-	int reg;
 
+	data = it87_update_device(dev, BIT_ULL(IT87_SLICE_PWM(nr)));
 	if (IS_ERR(data))
 		return PTR_ERR(data);
 
-	if (has_old_autopwm(data) || point)
-		reg = data->auto_temp[nr][point];
-	else
-		reg = data->auto_temp[nr][1] - (data->auto_temp[nr][0] & 0x1f);
+	return sprintf(buf, "%d\n", it87_auto_temp_from_reg(data, nr, point));
+}
 
-	return sprintf(buf, "%d\n", TEMP_FROM_REG(reg));
+/* Must be called with it87_lock() held */
+static void it87_write_auto_temp(struct it87_data *data, int nr, int point,
+				 long val)
+{
+	int reg;
+
+	if (has_newer_autopwm(data) && !point) {
+		reg = data->auto_temp[nr][1] - TEMP_TO_REG(val);
+		reg = clamp_val(reg, 0, 0x1f) | (data->auto_temp[nr][0] & 0xe0);
+		data->auto_temp[nr][0] = reg;
+		data->write(data, IT87_REG_AUTO_TEMP(nr, 5), reg);
+	} else {
+		reg = TEMP_TO_REG(val);
+		data->auto_temp[nr][point] = reg;
+		if (has_newer_autopwm(data))
+			point--;
+		data->write(data, IT87_REG_AUTO_TEMP(nr, point), reg);
+	}
 }
 
 static ssize_t set_auto_temp(struct device *dev, struct device_attribute *attr,
@@ -2247,7 +3009,6 @@ static ssize_t set_auto_temp(struct device *dev, struct device_attribute *attr,
 	int nr = sensor_attr->nr;
 	int point = sensor_attr->index;
 	long val;
-	int reg;
 	int err;
 
 	if (kstrtol(buf, 10, &val) < 0 || val < -128000 || val > 127000)
@@ -2257,59 +3018,326 @@ static ssize_t set_auto_temp(struct device *dev, struct device_attribute *attr,
 	if (err)
 		return err;
 
-	if (has_newer_autopwm(data) && !point) {
-		reg = data->auto_temp[nr][1] - TEMP_TO_REG(val);
-		reg = clamp_val(reg, 0, 0x1f) | (data->auto_temp[nr][0] & 0xe0);
-		data->auto_temp[nr][0] = reg;
-		data->write(data, IT87_REG_AUTO_TEMP(nr, 5), reg);
+	it87_write_auto_temp(data, nr, point, val);
+	it87_unlock(data);
+	return count;
+}
+
+/*
+ * A whole fan curve in one file, in the order of the individual
+ * pwmX_auto_* attributes of the channel. Writing it updates all points
+ * under a single it87_lock(), so the SMBus is isolated only once.
+ */
+enum it87_auto_kind { IT87_AUTO_PWM, IT87_AUTO_TEMP, IT87_AUTO_SLOPE };
+
+struct it87_auto_point {
+	u8 kind;
+	u8 point;
+};
+
+static const struct it87_auto_point it87_auto_points_old[] = {
+	{ IT87_AUTO_PWM, 0 },	/* auto_point1_pwm */
+	{ IT87_AUTO_PWM, 1 },	/* auto_point2_pwm */
+	{ IT87_AUTO_PWM, 2 },	/* auto_point3_pwm */
+	{ IT87_AUTO_TEMP, 1 },	/* auto_point1_temp */
+	{ IT87_AUTO_TEMP, 0 },	/* auto_point1_temp_hyst */
+	{ IT87_AUTO_TEMP, 2 },	/* auto_point2_temp */
+	{ IT87_AUTO_TEMP, 3 },	/* auto_point3_temp */
+	{ IT87_AUTO_TEMP, 4 },	/* auto_point4_temp */
+};
+
+/* The hysteresis is relative to point1, so point1 must be written first */
+static const struct it87_auto_point it87_auto_points_newer[] = {
+	{ IT87_AUTO_TEMP, 1 },	/* auto_point1_temp */
+	{ IT87_AUTO_TEMP, 0 },	/* auto_point1_temp_hyst */
+	{ IT87_AUTO_TEMP, 2 },	/* auto_point2_temp */
+	{ IT87_AUTO_TEMP, 3 },	/* auto_point3_temp */
+	{ IT87_AUTO_PWM, 0 },	/* auto_start */
+	{ IT87_AUTO_SLOPE, 0 },	/* auto_slope */
+};
+
+static const struct it87_auto_point *
+it87_auto_points(const struct it87_data *data, int *count)
+{
+	if (has_newer_autopwm(data)) {
+		*count = ARRAY_SIZE(it87_auto_points_newer);
+		return it87_auto_points_newer;
+	}
+	*count = ARRAY_SIZE(it87_auto_points_old);
+	return it87_auto_points_old;
+}
+
+static ssize_t show_auto_points(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct sensor_device_attribute *sensor_attr = to_sensor_dev_attr(attr);
+	const struct it87_auto_point *points;
+	int nr = sensor_attr->index;
+	struct it87_data *data;
+	int i, n, len = 0;
+	int val;
+
+	data = it87_update_device(dev, BIT_ULL(IT87_SLICE_PWM(nr)));
+	if (IS_ERR(data))
+		return PTR_ERR(data);
+
+	points = it87_auto_points(data, &n);
+	for (i = 0; i < n; i++) {
+		switch (points[i].kind) {
+		case IT87_AUTO_PWM:
+			val = pwm_from_reg(data,
+					   data->auto_pwm[nr][points[i].point]);
+			break;
+		case IT87_AUTO_TEMP:
+			val = it87_auto_temp_from_reg(data, nr,
+						      points[i].point);
+			break;
+		default:
+			val = data->auto_pwm[nr][1] & 0x7f;
+			break;
+		}
+		len += sprintf(buf + len, "%d%c", val, i < n - 1 ? ' ' : '\n');
+	}
+	return len;
+}
+
+static ssize_t set_auto_points(struct device *dev,
+			       struct device_attribute *attr,
+			       const char *buf, size_t count)
+{
+	struct sensor_device_attribute *sensor_attr = to_sensor_dev_attr(attr);
+	struct it87_data *data = dev_get_drvdata(dev);
+	const struct it87_auto_point *points;
+	int nr = sensor_attr->index;
+	long vals[ARRAY_SIZE(it87_auto_points_old)];
+	int i, n, len, err;
+
+	points = it87_auto_points(data, &n);
+	for (i = 0; i < n; i++) {
+		if (sscanf(buf, "%ld%n", &vals[i], &len) != 1)
+			return -EINVAL;
+		buf += len;
+
+		switch (points[i].kind) {
+		case IT87_AUTO_PWM:
+			if (vals[i] < 0 || vals[i] > 255)
+				return -EINVAL;
+			break;
+		case IT87_AUTO_TEMP:
+			if (vals[i] < -128000 || vals[i] > 127000)
+				return -EINVAL;
+			break;
+		default:
+			if (vals[i] < 0 || vals[i] > 127)
+				return -EINVAL;
+			break;
+		}
+	}
+	if (*skip_spaces(buf))
+		return -EINVAL;
+
+	err = it87_lock(data);
+	if (err)
+		return err;
+
+	for (i = 0; i < n; i++) {
+		switch (points[i].kind) {
+		case IT87_AUTO_PWM:
+			it87_write_auto_pwm(data, nr, points[i].point, vals[i]);
+			break;
+		case IT87_AUTO_TEMP:
+			it87_write_auto_temp(data, nr, points[i].point,
+					     vals[i]);
+			break;
+		default:
+			it87_write_auto_slope(data, nr, vals[i]);
+			break;
+		}
+	}
+	it87_unlock(data);
+	return count;
+}
+
+/*
+ * A fan curve given as temperature:pwm points, fitted to the trip points
+ * of the chip. Newer chips run the fan at auto_start from point1 to point2,
+ * then ramp up by auto_slope / 8 PWM steps per degree C and reach full
+ * speed at point3. Older chips have three PWM steps at point1..3 and full
+ * speed at point4; the curve is sampled at evenly spaced temperatures.
+ */
+#define IT87_CURVE_MAX_POINTS	8
+
+struct it87_curve_point {
+	long temp;		/* millidegree C */
+	long pwm;		/* 0-255 */
+};
+
+/* PWM of the piecewise linear curve at @temp */
+static long it87_curve_at(const struct it87_curve_point *pts, int n,
+			  long temp)
+{
+	int i;
+
+	if (temp <= pts[0].temp)
+		return pts[0].pwm;
+	for (i = 1; i < n; i++) {
+		if (temp <= pts[i].temp)
+			return pts[i - 1].pwm +
+			       (pts[i].pwm - pts[i - 1].pwm) *
+			       (temp - pts[i - 1].temp) /
+			       (pts[i].temp - pts[i - 1].temp);
+	}
+	return pts[n - 1].pwm;
+}
+
+/* Lowest temperature at which the curve reaches full speed */
+static long it87_curve_full(const struct it87_curve_point *pts, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		if (pts[i].pwm == 0xff)
+			return pts[i].temp;
+	}
+	return pts[n - 1].temp;
+}
+
+/* Must be called with it87_lock() held */
+static void it87_write_curve_newer(struct it87_data *data, int nr,
+				   const struct it87_curve_point *pts, int n)
+{
+	long start = pts[0].pwm;
+	s64 num = 0, den = 0;
+	long t2, t3, dt;
+	int i, k, slope;
+
+	/* The ramp starts after the last point still at the start PWM */
+	for (k = 0; k < n - 1 && pts[k + 1].pwm == start; k++)
+		;
+	t2 = pts[k].temp;
+
+	/* Least squares slope of the points after the knee, through it */
+	for (i = k + 1; i < n; i++) {
+		dt = pts[i].temp - t2;
+		num += (s64)dt * (pts[i].pwm - start);
+		den += (s64)dt * dt;
+	}
+	slope = den ? div64_s64(num * 8000 + den / 2, den) : 0;
+	slope = clamp_val(slope, 0, 127);
+
+	if (!slope)
+		t3 = 127000;
+	else if (pts[n - 1].pwm == 0xff)
+		t3 = it87_curve_full(pts, n);
+	else
+		t3 = t2 + (0xff - start) * 8000 / slope;
+	t3 = clamp_val(t3, t2, 127000);
+
+	/* The hysteresis register is relative to point1 and stays as is */
+	it87_write_auto_temp(data, nr, 1, pts[0].temp);
+	it87_write_auto_temp(data, nr, 2, t2);
+	it87_write_auto_temp(data, nr, 3, t3);
+	it87_write_auto_pwm(data, nr, 0, start);
+	it87_write_auto_slope(data, nr, slope);
+}
+
+/* Must be called with it87_lock() held */
+static void it87_write_curve_old(struct it87_data *data, int nr,
+				 const struct it87_curve_point *pts, int n)
+{
+	long hyst = TEMP_FROM_REG(data->auto_temp[nr][1] -
+				  data->auto_temp[nr][0]);
+	long t1 = pts[0].temp;
+	long t4 = it87_curve_full(pts, n);
+	long temp;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		temp = t1 + (t4 - t1) * i / 3;
+		it87_write_auto_temp(data, nr, i + 1, temp);
+		it87_write_auto_pwm(data, nr, i, it87_curve_at(pts, n, temp));
+	}
+	it87_write_auto_temp(data, nr, 4, t4);
+	it87_write_auto_temp(data, nr, 0, clamp_val(t1 - hyst, -128000,
+						    127000));
+}
+
+static ssize_t show_curve(struct device *dev, struct device_attribute *attr,
+			  char *buf)
+{
+	struct sensor_device_attribute *sensor_attr = to_sensor_dev_attr(attr);
+	int nr = sensor_attr->index;
+	struct it87_data *data;
+	int i, len = 0;
+
+	data = it87_update_device(dev, BIT_ULL(IT87_SLICE_PWM(nr)));
+	if (IS_ERR(data))
+		return PTR_ERR(data);
+
+	if (has_newer_autopwm(data)) {
+		for (i = 1; i <= 3; i++)
+			len += sprintf(buf + len, "%d:%d%c",
+				       it87_auto_temp_from_reg(data, nr, i),
+				       i < 3 ? pwm_from_reg(data,
+						data->auto_pwm[nr][0]) : 0xff,
+				       i < 3 ? ' ' : '\n');
 	} else {
-		reg = TEMP_TO_REG(val);
-		data->auto_temp[nr][point] = reg;
-		if (has_newer_autopwm(data))
-			point--;
-		data->write(data, IT87_REG_AUTO_TEMP(nr, point), reg);
+		for (i = 1; i <= 4; i++)
+			len += sprintf(buf + len, "%d:%d%c",
+				       it87_auto_temp_from_reg(data, nr, i),
+				       i < 4 ? pwm_from_reg(data,
+						data->auto_pwm[nr][i - 1]) :
+					       0xff,
+				       i < 4 ? ' ' : '\n');
+	}
+	return len;
+}
+
+static ssize_t set_curve(struct device *dev, struct device_attribute *attr,
+			 const char *buf, size_t count)
+{
+	struct sensor_device_attribute *sensor_attr = to_sensor_dev_attr(attr);
+	struct it87_data *data = dev_get_drvdata(dev);
+	struct it87_curve_point pts[IT87_CURVE_MAX_POINTS];
+	int nr = sensor_attr->index;
+	int n, len, err;
+
+	for (n = 0; *skip_spaces(buf); n++) {
+		if (n == IT87_CURVE_MAX_POINTS ||
+		    sscanf(buf, " %ld:%ld%n", &pts[n].temp, &pts[n].pwm,
+			   &len) != 2)
+			return -EINVAL;
+		buf += len;
+
+		if (pts[n].temp < -128000 || pts[n].temp > 127000 ||
+		    pts[n].pwm < 0 || pts[n].pwm > 255)
+			return -EINVAL;
+		/* Rising temperatures, the fan never slows down */
+		if (n && (pts[n].temp <= pts[n - 1].temp ||
+			  pts[n].pwm < pts[n - 1].pwm))
+			return -EINVAL;
 	}
+	if (n < 2)
+		return -EINVAL;
+
+	err = it87_lock(data);
+	if (err)
+		return err;
+
+	/* Fresh trip points, the old style hysteresis is kept relative */
+	it87_update_pwm_ctrl(data, nr);
+	if (has_newer_autopwm(data))
+		it87_write_curve_newer(data, nr, pts, n);
+	else
+		it87_write_curve_old(data, nr, pts, n);
+
+	/* The fitted points are consistent, check_trip_points() would pass */
+	data->fan_loop_mask &= ~BIT(nr);
+	it87_write_pwm_ctrl_mode(data, nr, 2);
 	it87_unlock(data);
 	return count;
 }
 
-static SENSOR_DEVICE_ATTR_2(fan1_input, S_IRUGO, show_fan, NULL, 0, 0);
-static SENSOR_DEVICE_ATTR_2(fan1_min, S_IRUGO | S_IWUSR, show_fan, set_fan,
-			    0, 1);
-static SENSOR_DEVICE_ATTR(fan1_div, S_IRUGO | S_IWUSR, show_fan_div,
-			  set_fan_div, 0);
-
-static SENSOR_DEVICE_ATTR_2(fan2_input, S_IRUGO, show_fan, NULL, 1, 0);
-static SENSOR_DEVICE_ATTR_2(fan2_min, S_IRUGO | S_IWUSR, show_fan, set_fan,
-			    1, 1);
-static SENSOR_DEVICE_ATTR(fan2_div, S_IRUGO | S_IWUSR, show_fan_div,
-			  set_fan_div, 1);
-
-static SENSOR_DEVICE_ATTR_2(fan3_input, S_IRUGO, show_fan, NULL, 2, 0);
-static SENSOR_DEVICE_ATTR_2(fan3_min, S_IRUGO | S_IWUSR, show_fan, set_fan,
-			    2, 1);
-static SENSOR_DEVICE_ATTR(fan3_div, S_IRUGO | S_IWUSR, show_fan_div,
-			  set_fan_div, 2);
-
-static SENSOR_DEVICE_ATTR_2(fan4_input, S_IRUGO, show_fan, NULL, 3, 0);
-static SENSOR_DEVICE_ATTR_2(fan4_min, S_IRUGO | S_IWUSR, show_fan, set_fan,
-			    3, 1);
-
-static SENSOR_DEVICE_ATTR_2(fan5_input, S_IRUGO, show_fan, NULL, 4, 0);
-static SENSOR_DEVICE_ATTR_2(fan5_min, S_IRUGO | S_IWUSR, show_fan, set_fan,
-			    4, 1);
-
-static SENSOR_DEVICE_ATTR_2(fan6_input, S_IRUGO, show_fan, NULL, 5, 0);
-static SENSOR_DEVICE_ATTR_2(fan6_min, S_IRUGO | S_IWUSR, show_fan, set_fan,
-			    5, 1);
-
-static SENSOR_DEVICE_ATTR(pwm1_enable, S_IRUGO | S_IWUSR,
-			  show_pwm_enable, set_pwm_enable, 0);
-static SENSOR_DEVICE_ATTR(pwm1, S_IRUGO | S_IWUSR, show_pwm, set_pwm, 0);
-static SENSOR_DEVICE_ATTR(pwm1_freq, S_IRUGO | S_IWUSR, show_pwm_freq,
-			  set_pwm_freq, 0);
-static SENSOR_DEVICE_ATTR(pwm1_auto_channels_temp, S_IRUGO,
-			  show_pwm_temp_map, set_pwm_temp_map, 0);
 static SENSOR_DEVICE_ATTR_2(pwm1_auto_point1_pwm, S_IRUGO | S_IWUSR,
 			    show_auto_pwm, set_auto_pwm, 0, 0);
 static SENSOR_DEVICE_ATTR_2(pwm1_auto_point2_pwm, S_IRUGO | S_IWUSR,
@@ -2332,13 +3360,11 @@ static SENSOR_DEVICE_ATTR_2(pwm1_auto_start, S_IRUGO | S_IWUSR,
 			    show_auto_pwm, set_auto_pwm, 0, 0);
 static SENSOR_DEVICE_ATTR(pwm1_auto_slope, S_IRUGO | S_IWUSR,
 			  show_auto_pwm_slope, set_auto_pwm_slope, 0);
+static SENSOR_DEVICE_ATTR(pwm1_auto_points, S_IRUGO | S_IWUSR,
+			  show_auto_points, set_auto_points, 0);
+static SENSOR_DEVICE_ATTR(pwm1_curve, S_IRUGO | S_IWUSR,
+			  show_curve, set_curve, 0);
 
-static SENSOR_DEVICE_ATTR(pwm2_enable, S_IRUGO | S_IWUSR,
-			  show_pwm_enable, set_pwm_enable, 1);
-static SENSOR_DEVICE_ATTR(pwm2, S_IRUGO | S_IWUSR, show_pwm, set_pwm, 1);
-static SENSOR_DEVICE_ATTR(pwm2_freq, S_IRUGO, show_pwm_freq, set_pwm_freq, 1);
-static SENSOR_DEVICE_ATTR(pwm2_auto_channels_temp, S_IRUGO,
-			  show_pwm_temp_map, set_pwm_temp_map, 1);
 static SENSOR_DEVICE_ATTR_2(pwm2_auto_point1_pwm, S_IRUGO | S_IWUSR,
 			    show_auto_pwm, set_auto_pwm, 1, 0);
 static SENSOR_DEVICE_ATTR_2(pwm2_auto_point2_pwm, S_IRUGO | S_IWUSR,
@@ -2361,13 +3387,11 @@ static SENSOR_DEVICE_ATTR_2(pwm2_auto_start, S_IRUGO | S_IWUSR,
 			    show_auto_pwm, set_auto_pwm, 1, 0);
 static SENSOR_DEVICE_ATTR(pwm2_auto_slope, S_IRUGO | S_IWUSR,
 			  show_auto_pwm_slope, set_auto_pwm_slope, 1);
+static SENSOR_DEVICE_ATTR(pwm2_auto_points, S_IRUGO | S_IWUSR,
+			  show_auto_points, set_auto_points, 1);
+static SENSOR_DEVICE_ATTR(pwm2_curve, S_IRUGO | S_IWUSR,
+			  show_curve, set_curve, 1);
 
-static SENSOR_DEVICE_ATTR(pwm3_enable, S_IRUGO | S_IWUSR,
-			  show_pwm_enable, set_pwm_enable, 2);
-static SENSOR_DEVICE_ATTR(pwm3, S_IRUGO | S_IWUSR, show_pwm, set_pwm, 2);
-static SENSOR_DEVICE_ATTR(pwm3_freq, S_IRUGO, show_pwm_freq, NULL, 2);
-static SENSOR_DEVICE_ATTR(pwm3_auto_channels_temp, S_IRUGO,
-			  show_pwm_temp_map, set_pwm_temp_map, 2);
 static SENSOR_DEVICE_ATTR_2(pwm3_auto_point1_pwm, S_IRUGO | S_IWUSR,
 			    show_auto_pwm, set_auto_pwm, 2, 0);
 static SENSOR_DEVICE_ATTR_2(pwm3_auto_point2_pwm, S_IRUGO | S_IWUSR,
@@ -2390,13 +3414,11 @@ static SENSOR_DEVICE_ATTR_2(pwm3_auto_start, S_IRUGO | S_IWUSR,
 			    show_auto_pwm, set_auto_pwm, 2, 0);
 static SENSOR_DEVICE_ATTR(pwm3_auto_slope, S_IRUGO | S_IWUSR,
 			  show_auto_pwm_slope, set_auto_pwm_slope, 2);
+static SENSOR_DEVICE_ATTR(pwm3_auto_points, S_IRUGO | S_IWUSR,
+			  show_auto_points, set_auto_points, 2);
+static SENSOR_DEVICE_ATTR(pwm3_curve, S_IRUGO | S_IWUSR,
+			  show_curve, set_curve, 2);
 
-static SENSOR_DEVICE_ATTR(pwm4_enable, S_IRUGO | S_IWUSR,
-			  show_pwm_enable, set_pwm_enable, 3);
-static SENSOR_DEVICE_ATTR(pwm4, S_IRUGO | S_IWUSR, show_pwm, set_pwm, 3);
-static SENSOR_DEVICE_ATTR(pwm4_freq, S_IRUGO, show_pwm_freq, NULL, 3);
-static SENSOR_DEVICE_ATTR(pwm4_auto_channels_temp, S_IRUGO,
-			  show_pwm_temp_map, set_pwm_temp_map, 3);
 static SENSOR_DEVICE_ATTR_2(pwm4_auto_point1_temp, S_IRUGO | S_IWUSR,
 			    show_auto_temp, set_auto_temp, 2, 1);
 static SENSOR_DEVICE_ATTR_2(pwm4_auto_point1_temp_hyst, S_IRUGO | S_IWUSR,
@@ -2409,13 +3431,11 @@ static SENSOR_DEVICE_ATTR_2(pwm4_auto_start, S_IRUGO | S_IWUSR,
 			    show_auto_pwm, set_auto_pwm, 3, 0);
 static SENSOR_DEVICE_ATTR(pwm4_auto_slope, S_IRUGO | S_IWUSR,
 			  show_auto_pwm_slope, set_auto_pwm_slope, 3);
+static SENSOR_DEVICE_ATTR(pwm4_auto_points, S_IRUGO | S_IWUSR,
+			  show_auto_points, set_auto_points, 3);
+static SENSOR_DEVICE_ATTR(pwm4_curve, S_IRUGO | S_IWUSR,
+			  show_curve, set_curve, 3);
 
-static SENSOR_DEVICE_ATTR(pwm5_enable, S_IRUGO | S_IWUSR,
-			  show_pwm_enable, set_pwm_enable, 4);
-static SENSOR_DEVICE_ATTR(pwm5, S_IRUGO | S_IWUSR, show_pwm, set_pwm, 4);
-static SENSOR_DEVICE_ATTR(pwm5_freq, S_IRUGO, show_pwm_freq, NULL, 4);
-static SENSOR_DEVICE_ATTR(pwm5_auto_channels_temp, S_IRUGO,
-			  show_pwm_temp_map, set_pwm_temp_map, 4);
 static SENSOR_DEVICE_ATTR_2(pwm5_auto_point1_temp, S_IRUGO | S_IWUSR,
 			    show_auto_temp, set_auto_temp, 2, 1);
 static SENSOR_DEVICE_ATTR_2(pwm5_auto_point1_temp_hyst, S_IRUGO | S_IWUSR,
@@ -2428,13 +3448,11 @@ static SENSOR_DEVICE_ATTR_2(pwm5_auto_start, S_IRUGO | S_IWUSR,
 			    show_auto_pwm, set_auto_pwm, 4, 0);
 static SENSOR_DEVICE_ATTR(pwm5_auto_slope, S_IRUGO | S_IWUSR,
 			  show_auto_pwm_slope, set_auto_pwm_slope, 4);
+static SENSOR_DEVICE_ATTR(pwm5_auto_points, S_IRUGO | S_IWUSR,
+			  show_auto_points, set_auto_points, 4);
+static SENSOR_DEVICE_ATTR(pwm5_curve, S_IRUGO | S_IWUSR,
+			  show_curve, set_curve, 4);
 
-static SENSOR_DEVICE_ATTR(pwm6_enable, S_IRUGO | S_IWUSR,
-			  show_pwm_enable, set_pwm_enable, 5);
-static SENSOR_DEVICE_ATTR(pwm6, S_IRUGO | S_IWUSR, show_pwm, set_pwm, 5);
-static SENSOR_DEVICE_ATTR(pwm6_freq, S_IRUGO, show_pwm_freq, NULL, 5);
-static SENSOR_DEVICE_ATTR(pwm6_auto_channels_temp, S_IRUGO,
-			  show_pwm_temp_map, set_pwm_temp_map, 5);
 static SENSOR_DEVICE_ATTR_2(pwm6_auto_point1_temp, S_IRUGO | S_IWUSR,
 			    show_auto_temp, set_auto_temp, 2, 1);
 static SENSOR_DEVICE_ATTR_2(pwm6_auto_point1_temp_hyst, S_IRUGO | S_IWUSR,
@@ -2447,41 +3465,17 @@ static SENSOR_DEVICE_ATTR_2(pwm6_auto_start, S_IRUGO | S_IWUSR,
 			    show_auto_pwm, set_auto_pwm, 5, 0);
 static SENSOR_DEVICE_ATTR(pwm6_auto_slope, S_IRUGO | S_IWUSR,
 			  show_auto_pwm_slope, set_auto_pwm_slope, 5);
+static SENSOR_DEVICE_ATTR(pwm6_auto_points, S_IRUGO | S_IWUSR,
+			  show_auto_points, set_auto_points, 5);
+static SENSOR_DEVICE_ATTR(pwm6_curve, S_IRUGO | S_IWUSR,
+			  show_curve, set_curve, 5);
 
-/* Alarms */
-static ssize_t alarms_show(struct device *dev, struct device_attribute *attr,
-			   char *buf)
-{
-	struct it87_data *data = it87_update_device(dev);
-
-	if (IS_ERR(data))
-		return PTR_ERR(data);
-
-	return sprintf(buf, "%u\n", data->alarms);
-}
-static DEVICE_ATTR_RO(alarms);
-
-static ssize_t show_alarm(struct device *dev, struct device_attribute *attr,
-			  char *buf)
-{
-	struct it87_data *data = it87_update_device(dev);
-	int bitnr = to_sensor_dev_attr(attr)->index;
-
-	if (IS_ERR(data))
-		return PTR_ERR(data);
-
-	return sprintf(buf, "%u\n", (data->alarms >> bitnr) & 1);
-}
-
-static ssize_t clear_intrusion(struct device *dev,
-			       struct device_attribute *attr, const char *buf,
-			       size_t count)
+static int it87_clear_intrusion(struct device *dev, long val)
 {
 	struct it87_data *data = dev_get_drvdata(dev);
 	int err, config;
-	long val;
 
-	if (kstrtol(buf, 10, &val) < 0 || val != 0)
+	if (val != 0)
 		return -EINVAL;
 
 	err = it87_lock(data);
@@ -2491,95 +3485,46 @@ static ssize_t clear_intrusion(struct device *dev,
 	config = data->read(data, IT87_REG_CONFIG);
 	config |= BIT(5);
 	data->write(data, IT87_REG_CONFIG, config);
-	/* Invalidate cache to force re-read */
-	data->valid = false;
-	it87_unlock(data);
-	return count;
-}
-
-static SENSOR_DEVICE_ATTR(in0_alarm, S_IRUGO, show_alarm, NULL, 8);
-static SENSOR_DEVICE_ATTR(in1_alarm, S_IRUGO, show_alarm, NULL, 9);
-static SENSOR_DEVICE_ATTR(in2_alarm, S_IRUGO, show_alarm, NULL, 10);
-static SENSOR_DEVICE_ATTR(in3_alarm, S_IRUGO, show_alarm, NULL, 11);
-static SENSOR_DEVICE_ATTR(in4_alarm, S_IRUGO, show_alarm, NULL, 12);
-static SENSOR_DEVICE_ATTR(in5_alarm, S_IRUGO, show_alarm, NULL, 13);
-static SENSOR_DEVICE_ATTR(in6_alarm, S_IRUGO, show_alarm, NULL, 14);
-static SENSOR_DEVICE_ATTR(in7_alarm, S_IRUGO, show_alarm, NULL, 15);
-static SENSOR_DEVICE_ATTR(fan1_alarm, S_IRUGO, show_alarm, NULL, 0);
-static SENSOR_DEVICE_ATTR(fan2_alarm, S_IRUGO, show_alarm, NULL, 1);
-static SENSOR_DEVICE_ATTR(fan3_alarm, S_IRUGO, show_alarm, NULL, 2);
-static SENSOR_DEVICE_ATTR(fan4_alarm, S_IRUGO, show_alarm, NULL, 3);
-static SENSOR_DEVICE_ATTR(fan5_alarm, S_IRUGO, show_alarm, NULL, 6);
-static SENSOR_DEVICE_ATTR(fan6_alarm, S_IRUGO, show_alarm, NULL, 7);
-static SENSOR_DEVICE_ATTR(temp1_alarm, S_IRUGO, show_alarm, NULL, 16);
-static SENSOR_DEVICE_ATTR(temp2_alarm, S_IRUGO, show_alarm, NULL, 17);
-static SENSOR_DEVICE_ATTR(temp3_alarm, S_IRUGO, show_alarm, NULL, 18);
-static SENSOR_DEVICE_ATTR(temp4_alarm, S_IRUGO, show_alarm, NULL, 19);
-static SENSOR_DEVICE_ATTR(temp5_alarm, S_IRUGO, show_alarm, NULL, 20);
-static SENSOR_DEVICE_ATTR(temp6_alarm, S_IRUGO, show_alarm, NULL, 21);
-static SENSOR_DEVICE_ATTR(intrusion0_alarm, S_IRUGO | S_IWUSR,
-			  show_alarm, clear_intrusion, 4);
-
-static ssize_t show_beep(struct device *dev, struct device_attribute *attr,
-			 char *buf)
-{
-	struct it87_data *data = it87_update_device(dev);
-	int bitnr = to_sensor_dev_attr(attr)->index;
-
-	if (IS_ERR(data))
-		return PTR_ERR(data);
-
-	return sprintf(buf, "%u\n", (data->beeps >> bitnr) & 1);
-}
-
-static ssize_t set_beep(struct device *dev, struct device_attribute *attr,
-			const char *buf, size_t count)
-{
-	int bitnr = to_sensor_dev_attr(attr)->index;
-	struct it87_data *data = dev_get_drvdata(dev);
-	long val;
-	int err;
-
-	if (kstrtol(buf, 10, &val) < 0 || (val != 0 && val != 1))
-		return -EINVAL;
-
-	err = it87_lock(data);
-	if (err)
-		return err;
-
-	data->beeps = data->read(data, IT87_REG_BEEP_ENABLE);
-	if (val)
-		data->beeps |= BIT(bitnr);
-	else
-		data->beeps &= ~BIT(bitnr);
-	data->write(data, IT87_REG_BEEP_ENABLE, data->beeps);
+	/* Invalidate cache to force re-read */
+	it87_invalidate(data);
 	it87_unlock(data);
-	return count;
+	return 0;
+}
+
+static int it87_read_chip(struct device *dev, u32 attr, long *val)
+{
+	struct it87_data *data;
+
+	switch (attr) {
+	case hwmon_chip_update_interval:
+		data = dev_get_drvdata(dev);
+		*val = data->update_interval;
+		return 0;
+	case hwmon_chip_alarms:
+		data = it87_update_device(dev, BIT_ULL(IT87_SLICE_ALARM));
+		if (IS_ERR(data))
+			return PTR_ERR(data);
+		*val = data->alarms;
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
 }
 
-static SENSOR_DEVICE_ATTR(in0_beep, S_IRUGO | S_IWUSR,
-			  show_beep, set_beep, 1);
-static SENSOR_DEVICE_ATTR(in1_beep, S_IRUGO, show_beep, NULL, 1);
-static SENSOR_DEVICE_ATTR(in2_beep, S_IRUGO, show_beep, NULL, 1);
-static SENSOR_DEVICE_ATTR(in3_beep, S_IRUGO, show_beep, NULL, 1);
-static SENSOR_DEVICE_ATTR(in4_beep, S_IRUGO, show_beep, NULL, 1);
-static SENSOR_DEVICE_ATTR(in5_beep, S_IRUGO, show_beep, NULL, 1);
-static SENSOR_DEVICE_ATTR(in6_beep, S_IRUGO, show_beep, NULL, 1);
-static SENSOR_DEVICE_ATTR(in7_beep, S_IRUGO, show_beep, NULL, 1);
-/* fanX_beep writability is set later */
-static SENSOR_DEVICE_ATTR(fan1_beep, S_IRUGO, show_beep, set_beep, 0);
-static SENSOR_DEVICE_ATTR(fan2_beep, S_IRUGO, show_beep, set_beep, 0);
-static SENSOR_DEVICE_ATTR(fan3_beep, S_IRUGO, show_beep, set_beep, 0);
-static SENSOR_DEVICE_ATTR(fan4_beep, S_IRUGO, show_beep, set_beep, 0);
-static SENSOR_DEVICE_ATTR(fan5_beep, S_IRUGO, show_beep, set_beep, 0);
-static SENSOR_DEVICE_ATTR(fan6_beep, S_IRUGO, show_beep, set_beep, 0);
-static SENSOR_DEVICE_ATTR(temp1_beep, S_IRUGO | S_IWUSR,
-			  show_beep, set_beep, 2);
-static SENSOR_DEVICE_ATTR(temp2_beep, S_IRUGO, show_beep, NULL, 2);
-static SENSOR_DEVICE_ATTR(temp3_beep, S_IRUGO, show_beep, NULL, 2);
-static SENSOR_DEVICE_ATTR(temp4_beep, S_IRUGO, show_beep, NULL, 2);
-static SENSOR_DEVICE_ATTR(temp5_beep, S_IRUGO, show_beep, NULL, 2);
-static SENSOR_DEVICE_ATTR(temp6_beep, S_IRUGO, show_beep, NULL, 2);
+static int it87_write_chip(struct device *dev, u32 attr, long val)
+{
+	struct it87_data *data = dev_get_drvdata(dev);
+
+	switch (attr) {
+	case hwmon_chip_update_interval:
+		mutex_lock(&data->update_lock);
+		data->update_interval = clamp_val(val, 0, 60000);
+		mutex_unlock(&data->update_lock);
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
 
 static ssize_t vrm_show(struct device *dev, struct device_attribute *attr,
 			char *buf)
@@ -2607,8 +3552,9 @@ static DEVICE_ATTR_RW(vrm);
 static ssize_t cpu0_vid_show(struct device *dev,
 			     struct device_attribute *attr, char *buf)
 {
-	struct it87_data *data = it87_update_device(dev);
+	struct it87_data *data;
 
+	data = it87_update_device(dev, BIT_ULL(IT87_SLICE_CTRL));
 	if (IS_ERR(data))
 		return PTR_ERR(data);
 
@@ -2616,42 +3562,6 @@ static ssize_t cpu0_vid_show(struct device *dev,
 }
 static DEVICE_ATTR_RO(cpu0_vid);
 
-static ssize_t show_label(struct device *dev, struct device_attribute *attr,
-			  char *buf)
-{
-	static const char * const labels[] = {
-		"+5V",
-		"5VSB",
-		"Vbat",
-		"AVCC",
-	};
-	static const char * const labels_it8721[] = {
-		"+3.3V",
-		"3VSB",
-		"Vbat",
-		"+3.3V",
-	};
-	struct it87_data *data = dev_get_drvdata(dev);
-	int nr = to_sensor_dev_attr(attr)->index;
-	const char *label;
-
-	if (has_vin3_5v(data) && nr == 0)
-		label = labels[0];
-	else if (has_12mv_adc(data) || has_10_9mv_adc(data) ||
-			has_11mv_adc(data))
-		label = labels_it8721[nr];
-	else
-		label = labels[nr];
-
-	return sprintf(buf, "%s\n", label);
-}
-static SENSOR_DEVICE_ATTR(in3_label, S_IRUGO, show_label, NULL, 0);
-static SENSOR_DEVICE_ATTR(in7_label, S_IRUGO, show_label, NULL, 1);
-static SENSOR_DEVICE_ATTR(in8_label, S_IRUGO, show_label, NULL, 2);
-/* AVCC3 */
-static SENSOR_DEVICE_ATTR(in9_label, S_IRUGO, show_label, NULL, 3);
-
-
 /* #### GP LED blinking control #### */
 
 /* Documentation:
@@ -2788,21 +3698,11 @@ static ssize_t show_gpled_blink(struct device *dev, struct device_attribute *att
 #endif
 }
 
-static ssize_t set_gpled_blink(struct device *dev, struct device_attribute *attr,
-                               const char *buf, size_t count)
+/* map GP LED slot nr to gpled (in it87_gpXY numbering), 0 unmaps the slot */
+static int it87_gpled_map(struct it87_data *data, int nr, long gpled)
 {
-	struct sensor_device_attribute_2 *sattr = to_sensor_dev_attr_2(attr);
-	struct it87_data *data = dev_get_drvdata(dev);
-	int led_map_reg = IT87_REG_GP_LED_CTRL_PIN_MAPPING[sattr->index];
+	int led_map_reg = IT87_REG_GP_LED_CTRL_PIN_MAPPING[nr];
 	int err, loc, oldloc, ledfnbit;
-	long val;
-
-	/* the input value is like in it87_gpXY, where Y is 0..7 as it's a bit index apparently?
-	   and, as far as I can tell, X <= 8 */
-	if (0 > kstrtol(buf, 10, &val) || (val % 10) >= 8 || (val / 10) > 8) {
-		pr_info("set_gpled_blink(): invalid value %s\n", buf);
-		return -EINVAL;
-	}
 
 	/* switch the old/current blinking LED pin back to the "Simple I/O function"
 	 * (instead of "alternate function") so it can be controlled normally again
@@ -2815,16 +3715,34 @@ static ssize_t set_gpled_blink(struct device *dev, struct device_attribute *attr
 	}
 
 	/* switch new blinking LED pin to "alternate function" mode so it can blink */
-	if(val != 0) {
-		ledfnbit = GPLED_TO_ALT_FN_SEL_BIT(val);
-		err = update_gpio_reg(data, GPLED_TO_ALT_FN_SEL_REG(val), 0, ~ledfnbit);
+	if(gpled != 0) {
+		ledfnbit = GPLED_TO_ALT_FN_SEL_BIT(gpled);
+		err = update_gpio_reg(data, GPLED_TO_ALT_FN_SEL_REG(gpled), 0, ~ledfnbit);
 		if(err)
 			return err;
 	}
 
-	loc = GPLED_TO_LOCATION(val);
+	loc = GPLED_TO_LOCATION(gpled);
 	/* preserve bits 6 and 7 of the register, replace the rest with loc */
-	err = update_gpio_reg(data, led_map_reg, loc, BIT(6) | BIT(7));
+	return update_gpio_reg(data, led_map_reg, loc, BIT(6) | BIT(7));
+}
+
+static ssize_t set_gpled_blink(struct device *dev, struct device_attribute *attr,
+                               const char *buf, size_t count)
+{
+	struct sensor_device_attribute_2 *sattr = to_sensor_dev_attr_2(attr);
+	struct it87_data *data = dev_get_drvdata(dev);
+	int err;
+	long val;
+
+	/* the input value is like in it87_gpXY, where Y is 0..7 as it's a bit index apparently?
+	   and, as far as I can tell, X <= 8 */
+	if (0 > kstrtol(buf, 10, &val) || (val % 10) >= 8 || (val / 10) > 8) {
+		pr_info("set_gpled_blink(): invalid value %s\n", buf);
+		return -EINVAL;
+	}
+
+	err = it87_gpled_map(data, sattr->index, val);
 	if(err)
 		return err;
 
@@ -2922,34 +3840,176 @@ static ssize_t show_gpled_blink_freq(struct device * dev, struct device_attribut
 	}
 }
 
+/* set the blink mode (0-11, see blink_freq_desc[]) of GP LED slot nr */
+static int it87_gpled_set_mode(struct it87_data *data, int nr, int mode)
+{
+	u8 led_ctrl_reg = IT87_REG_GP_LED_CTRL_FREQ[nr];
+	bool advanced = (data->features & FEAT_BLINK_CTRL_ADV) != 0;
+	int keep_bits = BIT(5) | BIT(4);
+	if(!advanced) /* those bits are reserved on most chips */
+		keep_bits |= (BIT(6) | BIT(7));
+
+	/* keep only the bits of the register that aren't part of the frequency mode */
+	return update_gpio_reg(data, led_ctrl_reg,
+			       blink_mode_to_regvals(mode, advanced), keep_bits);
+}
+
 static ssize_t set_gpled_blink_freq(struct device *dev, struct device_attribute *attr,
                                     const char *buf, size_t count)
 {
 	struct sensor_device_attribute_2 *sattr = to_sensor_dev_attr_2(attr);
 	struct it87_data *data = dev_get_drvdata(dev);
-	u8 led_ctrl_reg = IT87_REG_GP_LED_CTRL_FREQ[sattr->index];
-	int err, blink_reg_val;
+	int err;
 	long val;
-	bool advanced = (data->features & FEAT_BLINK_CTRL_ADV) != 0;
-	int keep_bits = BIT(5) | BIT(4);
-	if(!advanced) /* those bits are reserved on most chips */
-		keep_bits |= (BIT(6) | BIT(7));
 
 	if (0 > kstrtol(buf, 10, &val) || val < 0 || val > 11)
 		return -EINVAL;
 	/* TODO(DanielGibson): could support negative values for "set BIT(5) aka "Short Low Pulse Enable"
 	   which seems to shorten the ON times, but that wouldn't work for index 0 of course */
 
-	blink_reg_val = blink_mode_to_regvals(val, advanced);
-
-	/* keep only the bits of the register that aren't part of the frequency mode */
-	err = update_gpio_reg(data, led_ctrl_reg, blink_reg_val, keep_bits);
+	err = it87_gpled_set_mode(data, sattr->index, val);
 	if(err)
 		return err;
 
 	return count;
 }
 
+struct it87_blink_timing {
+	u16 on, off;
+};
+
+/* LED on/off times in ms of the blink modes in the table above */
+static const struct it87_blink_timing it87_blink_modes_adv[] = {
+	{ 125, 125 }, { 500, 500 }, { 2000, 2000 }, { 250, 250 },
+	{ 3000, 1000 }, { 1000, 3000 }, { 6000, 2000 }, { 2000, 6000 },
+	{ 2000, 500 }, { 1000, 1000 }, { 4000, 4000 },
+};
+
+/* without FEAT_BLINK_CTRL_ADV, bits 1-2 select 4Hz, 1Hz, 0.25Hz or 0.125Hz */
+static const struct it87_blink_timing it87_blink_modes[] = {
+	{ 125, 125 }, { 500, 500 }, { 2000, 2000 }, { 4000, 4000 },
+};
+
+static const struct it87_blink_timing *
+it87_blink_timings(const struct it87_data *data, int *nmodes)
+{
+	if (data->features & FEAT_BLINK_CTRL_ADV) {
+		*nmodes = ARRAY_SIZE(it87_blink_modes_adv);
+		return it87_blink_modes_adv;
+	}
+	*nmodes = ARRAY_SIZE(it87_blink_modes);
+	return it87_blink_modes;
+}
+
+/* nearest blink mode, or -EINVAL if none is within 25% of the period */
+static int it87_blink_mode(const struct it87_data *data, unsigned long on,
+			   unsigned long off)
+{
+	const struct it87_blink_timing *modes;
+	unsigned long diff, best_diff = ULONG_MAX;
+	int i, nmodes, best = -EINVAL;
+
+	modes = it87_blink_timings(data, &nmodes);
+	for (i = 0; i < nmodes; i++) {
+		diff = abs((long)on - modes[i].on) +
+		       abs((long)off - modes[i].off);
+		if (diff < best_diff) {
+			best_diff = diff;
+			best = i;
+		}
+	}
+
+	if (best_diff * 4 > on + off)
+		return -EINVAL;
+	return best;
+}
+
+/* GP LED slot currently mapped to gpled, or -1 */
+static int it87_gpled_find(struct it87_data *data, int gpled)
+{
+	int i, reg_val;
+
+	for (i = 0; i < ARRAY_SIZE(IT87_REG_GP_LED_CTRL_PIN_MAPPING); i++) {
+		reg_val = read_gpio_reg(data, IT87_REG_GP_LED_CTRL_PIN_MAPPING[i]);
+		if (reg_val >= 0 && (reg_val & 63) == GPLED_TO_LOCATION(gpled))
+			return i;
+	}
+	return -1;
+}
+
+/**
+ * asustor_it87_gpled_blink - blink a GPIO of the IT87 in hardware
+ * @gpio: GPIO line, numbered like in asustor_gpio_it87 (it87_gpXY = 8 * (X - 1) + Y)
+ * @delay_on: requested LED on time in ms, set to the actual time; NULL stops
+ *	blinking @gpio and returns the pin to Simple I/O
+ * @delay_off: requested LED off time in ms, set to the actual time
+ *
+ * Reuses the GP LED slot already mapped to @gpio, or else a free one. Returns
+ * -EBUSY if both slots are taken and -EINVAL if no blink mode is close to the
+ * requested times, so the caller can fall back to blinking in software.
+ * Only valid for active low LEDs. May sleep.
+ */
+int asustor_it87_gpled_blink(unsigned int gpio, unsigned long *delay_on,
+			     unsigned long *delay_off)
+{
+	const struct it87_blink_timing *modes;
+	struct it87_data *data = NULL;
+	int i, nr, mode, nmodes, gpled, err = 0;
+
+	for (i = 0; i < ARRAY_SIZE(it87_pdev) && !data; i++) {
+		if (it87_pdev[i])
+			data = platform_get_drvdata(it87_pdev[i]);
+		if (data && !(data->features & FEAT_BLINK_CTRL))
+			data = NULL;
+	}
+	if (!data)
+		return -ENODEV;
+	if (gpio >= 64)
+		return -EINVAL;
+
+	gpled = (gpio / 8 + 1) * 10 + gpio % 8;
+
+	mutex_lock(&data->update_lock);
+
+	nr = it87_gpled_find(data, gpled);
+	if (!delay_on) {
+		if (nr >= 0)
+			err = it87_gpled_map(data, nr, 0);
+		goto unlock;
+	}
+
+	/* no times given, pick a sensible default like the LED core does */
+	if (!*delay_on && !*delay_off)
+		mode = 1;
+	else
+		mode = it87_blink_mode(data, *delay_on, *delay_off);
+	if (mode < 0) {
+		err = mode;
+		goto unlock;
+	}
+
+	if (nr < 0)
+		nr = it87_gpled_find(data, 0);
+	if (nr < 0) {
+		err = -EBUSY;
+		goto unlock;
+	}
+
+	err = it87_gpled_set_mode(data, nr, mode);
+	if (!err)
+		err = it87_gpled_map(data, nr, gpled);
+	if (!err) {
+		modes = it87_blink_timings(data, &nmodes);
+		*delay_on = modes[mode].on;
+		*delay_off = modes[mode].off;
+	}
+
+unlock:
+	mutex_unlock(&data->update_lock);
+	return err;
+}
+EXPORT_SYMBOL_GPL(asustor_it87_gpled_blink);
+
 static SENSOR_DEVICE_ATTR(gpled1_blink, S_IRUGO | S_IWUSR,
                           show_gpled_blink, set_gpled_blink, 0);
 static SENSOR_DEVICE_ATTR(gpled2_blink, S_IRUGO | S_IWUSR,
@@ -2963,341 +4023,457 @@ static SENSOR_DEVICE_ATTR(gpled2_blink_freq, S_IRUGO | S_IWUSR,
 /* #### end of IT8625 LED blinking control #### */
 
 
-static umode_t it87_in_is_visible(struct kobject *kobj,
-				  struct attribute *attr, int index)
+static umode_t it87_vid_is_visible(struct kobject *kobj,
+				   struct attribute *attr, int index)
 {
 	struct device *dev = kobj_to_dev(kobj);
 	struct it87_data *data = dev_get_drvdata(dev);
-	int i = index / 5;	/* voltage index */
-	int a = index % 5;	/* attribute index */
-
-	if (index >= 40) {	/* in8 and higher only have input attributes */
-		i = index - 40 + 8;
-		a = 0;
-	}
-
-	if (!(data->has_in & BIT(i)))
-		return 0;
 
-	if (a == 4 && !data->has_beep)
+	if (!data->has_vid)
 		return 0;
 
 	return attr->mode;
 }
 
-static struct attribute *it87_attributes_in[] = {
-	&sensor_dev_attr_in0_input.dev_attr.attr,
-	&sensor_dev_attr_in0_min.dev_attr.attr,
-	&sensor_dev_attr_in0_max.dev_attr.attr,
-	&sensor_dev_attr_in0_alarm.dev_attr.attr,
-	&sensor_dev_attr_in0_beep.dev_attr.attr,	/* 4 */
-
-	&sensor_dev_attr_in1_input.dev_attr.attr,
-	&sensor_dev_attr_in1_min.dev_attr.attr,
-	&sensor_dev_attr_in1_max.dev_attr.attr,
-	&sensor_dev_attr_in1_alarm.dev_attr.attr,
-	&sensor_dev_attr_in1_beep.dev_attr.attr,	/* 9 */
-
-	&sensor_dev_attr_in2_input.dev_attr.attr,
-	&sensor_dev_attr_in2_min.dev_attr.attr,
-	&sensor_dev_attr_in2_max.dev_attr.attr,
-	&sensor_dev_attr_in2_alarm.dev_attr.attr,
-	&sensor_dev_attr_in2_beep.dev_attr.attr,	/* 14 */
-
-	&sensor_dev_attr_in3_input.dev_attr.attr,
-	&sensor_dev_attr_in3_min.dev_attr.attr,
-	&sensor_dev_attr_in3_max.dev_attr.attr,
-	&sensor_dev_attr_in3_alarm.dev_attr.attr,
-	&sensor_dev_attr_in3_beep.dev_attr.attr,	/* 19 */
-
-	&sensor_dev_attr_in4_input.dev_attr.attr,
-	&sensor_dev_attr_in4_min.dev_attr.attr,
-	&sensor_dev_attr_in4_max.dev_attr.attr,
-	&sensor_dev_attr_in4_alarm.dev_attr.attr,
-	&sensor_dev_attr_in4_beep.dev_attr.attr,	/* 24 */
-
-	&sensor_dev_attr_in5_input.dev_attr.attr,
-	&sensor_dev_attr_in5_min.dev_attr.attr,
-	&sensor_dev_attr_in5_max.dev_attr.attr,
-	&sensor_dev_attr_in5_alarm.dev_attr.attr,
-	&sensor_dev_attr_in5_beep.dev_attr.attr,	/* 29 */
-
-	&sensor_dev_attr_in6_input.dev_attr.attr,
-	&sensor_dev_attr_in6_min.dev_attr.attr,
-	&sensor_dev_attr_in6_max.dev_attr.attr,
-	&sensor_dev_attr_in6_alarm.dev_attr.attr,
-	&sensor_dev_attr_in6_beep.dev_attr.attr,	/* 34 */
-
-	&sensor_dev_attr_in7_input.dev_attr.attr,
-	&sensor_dev_attr_in7_min.dev_attr.attr,
-	&sensor_dev_attr_in7_max.dev_attr.attr,
-	&sensor_dev_attr_in7_alarm.dev_attr.attr,
-	&sensor_dev_attr_in7_beep.dev_attr.attr,	/* 39 */
-
-	&sensor_dev_attr_in8_input.dev_attr.attr,	/* 40 */
-	&sensor_dev_attr_in9_input.dev_attr.attr,	/* 41 */
-	&sensor_dev_attr_in10_input.dev_attr.attr,	/* 42 */
-	&sensor_dev_attr_in11_input.dev_attr.attr,	/* 43 */
-	&sensor_dev_attr_in12_input.dev_attr.attr,	/* 44 */
-	NULL
+/*
+ * Binary record returned by the snapshot attribute, little endian. Bump
+ * IT87_SNAPSHOT_VERSION on any layout change; fields are only appended,
+ * so readers can rely on the size field to skip unknown trailing data.
+ * Values of channels missing from the has_* bitfields are zero.
+ */
+#define IT87_SNAPSHOT_VERSION	1
+
+struct it87_snapshot_channel {
+	__le16 raw;		/* Register value */
+	__le16 reserved;
+	__le32 value;		/* Scaled like the hwmon attribute, signed */
 };
 
-static const struct attribute_group it87_group_in = {
-	.attrs = it87_attributes_in,
-	.is_visible = it87_in_is_visible,
+struct it87_snapshot {
+	__le16 version;
+	__le16 size;		/* sizeof(struct it87_snapshot) */
+	__le16 has_in;
+	u8 has_fan;
+	u8 has_temp;
+	u8 has_pwm;
+	u8 reserved[3];
+	__le32 alarms;		/* Alarm register bits, combined */
+	__le64 updated_ns;	/* CLOCK_MONOTONIC time of the last update */
+	struct it87_snapshot_channel in[NUM_VIN];
+	struct it87_snapshot_channel fan[NUM_FAN];
+	struct it87_snapshot_channel temp[NUM_TEMP];
+	struct it87_snapshot_channel pwm[NUM_PWM];
 };
 
-static umode_t it87_temp_is_visible(struct kobject *kobj,
-				    struct attribute *attr, int index)
+static void it87_snapshot_set(struct it87_snapshot_channel *ch, u16 raw,
+			      long value)
 {
-	struct device *dev = kobj_to_dev(kobj);
-	struct it87_data *data = dev_get_drvdata(dev);
-	int i = index / 7;	/* temperature index */
-	int a = index % 7;	/* attribute index */
-
-	if (!(data->has_temp & BIT(i)))
-		return 0;
+	ch->raw = cpu_to_le16(raw);
+	ch->value = cpu_to_le32((s32)value);
+}
 
-	if (a && i >= data->num_temp_limit)
-		return 0;
+/* All measured values at once, for collectors that poll every channel */
+static ssize_t snapshot_read(struct file *file, struct kobject *kobj,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 13, 0)
+			     const struct bin_attribute *attr,
+#else
+			     struct bin_attribute *attr,
+#endif
+			     char *buf, loff_t off, size_t count)
+{
+	struct device *dev = kobj_to_dev(kobj);
+	struct it87_snapshot rec = { };
+	struct it87_data *data;
+	u16 fan;
+	int i;
 
-	if (a == 3) {
-		int type = get_temp_type(data, i);
+	data = it87_update_device(dev, IT87_ALL_SLICES);
+	if (IS_ERR(data))
+		return PTR_ERR(data);
 
-		if (type == 0)
-			return 0;
-		if (has_bank_sel(data))
-			return 0444;
-		return attr->mode;
+	mutex_lock(&data->update_lock);
+	rec.version = cpu_to_le16(IT87_SNAPSHOT_VERSION);
+	rec.size = cpu_to_le16(sizeof(rec));
+	rec.has_in = cpu_to_le16(data->has_in);
+	rec.has_fan = data->has_fan;
+	rec.has_temp = data->has_temp;
+	rec.has_pwm = data->has_pwm;
+	rec.alarms = cpu_to_le32(data->alarms);
+	rec.updated_ns = cpu_to_le64(data->updated_ns);
+
+	for (i = 0; i < NUM_VIN; i++) {
+		if (data->has_in & BIT(i))
+			it87_snapshot_set(&rec.in[i], data->in[i][0],
+					  in_from_reg(data, i, data->in[i][0]));
 	}
+	for (i = 0; i < NUM_FAN; i++) {
+		if (!(data->has_fan & BIT(i)))
+			continue;
+		fan = data->fan[i][0];
+		it87_snapshot_set(&rec.fan[i], fan, has_16bit_fans(data) ?
+				  FAN16_FROM_REG(fan) :
+				  FAN_FROM_REG(fan,
+					       DIV_FROM_REG(data->fan_div[i])));
+	}
+	for (i = 0; i < NUM_TEMP; i++) {
+		if (data->has_temp & BIT(i))
+			it87_snapshot_set(&rec.temp[i], (u8)data->temp[i][0],
+					  TEMP_FROM_REG(data->temp[i][0]));
+	}
+	for (i = 0; i < NUM_PWM; i++) {
+		if (data->has_pwm & BIT(i))
+			it87_snapshot_set(&rec.pwm[i], data->pwm_duty[i],
+					  pwm_from_reg(data,
+						       data->pwm_duty[i]));
+	}
+	mutex_unlock(&data->update_lock);
 
-	if (a == 5 && i >= data->num_temp_offset)
-		return 0;
-
-	if (a == 6 && !data->has_beep)
-		return 0;
-
-	return attr->mode;
+	return memory_read_from_buffer(buf, count, &off, &rec, sizeof(rec));
 }
+static BIN_ATTR_RO(snapshot, sizeof(struct it87_snapshot));
+
+static struct attribute *it87_attributes[] = {
+	&dev_attr_vrm.attr,
+	&dev_attr_cpu0_vid.attr,
+	NULL
+};
 
-static struct attribute *it87_attributes_temp[] = {
-	&sensor_dev_attr_temp1_input.dev_attr.attr,
-	&sensor_dev_attr_temp1_max.dev_attr.attr,
-	&sensor_dev_attr_temp1_min.dev_attr.attr,
-	&sensor_dev_attr_temp1_type.dev_attr.attr,	/* 3 */
-	&sensor_dev_attr_temp1_alarm.dev_attr.attr,
-	&sensor_dev_attr_temp1_offset.dev_attr.attr,	/* 5 */
-	&sensor_dev_attr_temp1_beep.dev_attr.attr,	/* 6 */
-
-	&sensor_dev_attr_temp2_input.dev_attr.attr,	/* 7 */
-	&sensor_dev_attr_temp2_max.dev_attr.attr,
-	&sensor_dev_attr_temp2_min.dev_attr.attr,
-	&sensor_dev_attr_temp2_type.dev_attr.attr,
-	&sensor_dev_attr_temp2_alarm.dev_attr.attr,
-	&sensor_dev_attr_temp2_offset.dev_attr.attr,
-	&sensor_dev_attr_temp2_beep.dev_attr.attr,
-
-	&sensor_dev_attr_temp3_input.dev_attr.attr,	/* 14 */
-	&sensor_dev_attr_temp3_max.dev_attr.attr,
-	&sensor_dev_attr_temp3_min.dev_attr.attr,
-	&sensor_dev_attr_temp3_type.dev_attr.attr,
-	&sensor_dev_attr_temp3_alarm.dev_attr.attr,
-	&sensor_dev_attr_temp3_offset.dev_attr.attr,
-	&sensor_dev_attr_temp3_beep.dev_attr.attr,
-
-	&sensor_dev_attr_temp4_input.dev_attr.attr,	/* 21 */
-	&sensor_dev_attr_temp4_max.dev_attr.attr,
-	&sensor_dev_attr_temp4_min.dev_attr.attr,
-	&sensor_dev_attr_temp4_type.dev_attr.attr,
-	&sensor_dev_attr_temp4_alarm.dev_attr.attr,
-	&sensor_dev_attr_temp4_offset.dev_attr.attr,
-	&sensor_dev_attr_temp4_beep.dev_attr.attr,
-
-	&sensor_dev_attr_temp5_input.dev_attr.attr,
-	&sensor_dev_attr_temp5_max.dev_attr.attr,
-	&sensor_dev_attr_temp5_min.dev_attr.attr,
-	&sensor_dev_attr_temp5_type.dev_attr.attr,
-	&sensor_dev_attr_temp5_alarm.dev_attr.attr,
-	&sensor_dev_attr_temp5_offset.dev_attr.attr,
-	&sensor_dev_attr_temp5_beep.dev_attr.attr,
-
-	&sensor_dev_attr_temp6_input.dev_attr.attr,
-	&sensor_dev_attr_temp6_max.dev_attr.attr,
-	&sensor_dev_attr_temp6_min.dev_attr.attr,
-	&sensor_dev_attr_temp6_type.dev_attr.attr,
-	&sensor_dev_attr_temp6_alarm.dev_attr.attr,
-	&sensor_dev_attr_temp6_offset.dev_attr.attr,
-	&sensor_dev_attr_temp6_beep.dev_attr.attr,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 13, 0)
+static const struct bin_attribute *const it87_bin_attributes[] = {
+#else
+static struct bin_attribute *it87_bin_attributes[] = {
+#endif
+	&bin_attr_snapshot,
 	NULL
 };
 
-static const struct attribute_group it87_group_temp = {
-	.attrs = it87_attributes_temp,
-	.is_visible = it87_temp_is_visible,
+static const struct attribute_group it87_group = {
+	.attrs = it87_attributes,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 13, 0) && \
+	LINUX_VERSION_CODE < KERNEL_VERSION(6, 17, 0)
+	.bin_attrs_new = it87_bin_attributes,
+#else
+	.bin_attrs = it87_bin_attributes,
+#endif
+	.is_visible = it87_vid_is_visible,
 };
 
-static umode_t it87_is_visible(struct kobject *kobj,
-			       struct attribute *attr, int index)
+/* Map a voltage channel to its in_internal bit, for labels */
+static int it87_in_label(int channel)
 {
-	struct device *dev = kobj_to_dev(kobj);
+	switch (channel) {
+	case 3:
+		return 0;
+	case 7:
+		return 1;
+	case 8:
+		return 2;
+	case 9:		/* AVCC3 */
+		return 3;
+	default:
+		return -1;
+	}
+}
+
+static int it87_read_string(struct device *dev, enum hwmon_sensor_types type,
+			    u32 attr, int channel, const char **str)
+{
+	static const char * const labels[] = {
+		"+5V",
+		"5VSB",
+		"Vbat",
+		"AVCC",
+	};
+	static const char * const labels_it8721[] = {
+		"+3.3V",
+		"3VSB",
+		"Vbat",
+		"+3.3V",
+	};
 	struct it87_data *data = dev_get_drvdata(dev);
+	int nr = it87_in_label(channel);
 
-	if ((index == 2 || index == 3) && !data->has_vid)
-		return 0;
+	if (type != hwmon_in || attr != hwmon_in_label || nr < 0)
+		return -EOPNOTSUPP;
 
-	if (index > 3 && !(data->in_internal & BIT(index - 4)))
-		return 0;
+	if (has_vin3_5v(data) && nr == 0)
+		*str = labels[0];
+	else if (has_12mv_adc(data) || has_10_9mv_adc(data) ||
+			has_11mv_adc(data))
+		*str = labels_it8721[nr];
+	else
+		*str = labels[nr];
 
-	return attr->mode;
+	return 0;
 }
 
-static struct attribute *it87_attributes[] = {
-	&dev_attr_alarms.attr,
-	&sensor_dev_attr_intrusion0_alarm.dev_attr.attr,
-	&dev_attr_vrm.attr,				/* 2 */
-	&dev_attr_cpu0_vid.attr,			/* 3 */
-	&sensor_dev_attr_in3_label.dev_attr.attr,	/* 4 .. 7 */
-	&sensor_dev_attr_in7_label.dev_attr.attr,
-	&sensor_dev_attr_in8_label.dev_attr.attr,
-	&sensor_dev_attr_in9_label.dev_attr.attr,
-	NULL
-};
+static int it87_read(struct device *dev, enum hwmon_sensor_types type,
+		     u32 attr, int channel, long *val)
+{
+	switch (type) {
+	case hwmon_chip:
+		return it87_read_chip(dev, attr, val);
+	case hwmon_in:
+		return it87_read_in(dev, attr, channel, val);
+	case hwmon_temp:
+		return it87_read_temp(dev, attr, channel, val);
+	case hwmon_fan:
+		return it87_read_fan(dev, attr, channel, val);
+	case hwmon_pwm:
+		return it87_read_pwm(dev, attr, channel, val);
+	case hwmon_intrusion:
+		return it87_read_alarm(dev, 4, val);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
 
-static const struct attribute_group it87_group = {
-	.attrs = it87_attributes,
-	.is_visible = it87_is_visible,
-};
+static int it87_write(struct device *dev, enum hwmon_sensor_types type,
+		      u32 attr, int channel, long val)
+{
+	switch (type) {
+	case hwmon_chip:
+		return it87_write_chip(dev, attr, val);
+	case hwmon_in:
+		return it87_write_in(dev, attr, channel, val);
+	case hwmon_temp:
+		return it87_write_temp(dev, attr, channel, val);
+	case hwmon_fan:
+		return it87_write_fan(dev, attr, channel, val);
+	case hwmon_pwm:
+		return it87_write_pwm(dev, attr, channel, val);
+	case hwmon_intrusion:
+		return it87_clear_intrusion(dev, val);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
 
-static umode_t it87_fan_is_visible(struct kobject *kobj,
-				   struct attribute *attr, int index)
+static umode_t it87_in_is_visible(const struct it87_data *data, u32 attr,
+				  int channel)
 {
-	struct device *dev = kobj_to_dev(kobj);
-	struct it87_data *data = dev_get_drvdata(dev);
-	int i = index / 5;	/* fan index */
-	int a = index % 5;	/* attribute index */
+	int nr;
+
+	if (attr == hwmon_in_label) {
+		nr = it87_in_label(channel);
+		if (nr < 0 || !(data->in_internal & BIT(nr)))
+			return 0;
+		return 0444;
+	}
+
+	if (!(data->has_in & BIT(channel)))
+		return 0;
 
-	if (index >= 15) {	/* fan 4..6 don't have divisor attributes */
-		i = (index - 15) / 4 + 3;
-		a = (index - 15) % 4;
+	switch (attr) {
+	case hwmon_in_input:
+		return 0444;
+	case hwmon_in_min:
+	case hwmon_in_max:
+		return channel < NUM_VIN_LIMIT ? 0644 : 0;
+	case hwmon_in_alarm:
+		return channel < NUM_VIN_LIMIT ? 0444 : 0;
+	case hwmon_in_beep:
+		if (!data->has_beep || channel >= NUM_VIN_LIMIT)
+			return 0;
+		/* in0_beep controls the beep of all voltage inputs */
+		return channel ? 0444 : 0644;
+	default:
+		return 0;
+	}
+}
+
+static umode_t it87_temp_is_visible(const struct it87_data *data, u32 attr,
+				    int channel)
+{
+	if (!(data->has_temp & BIT(channel)))
+		return 0;
+
+	if (attr != hwmon_temp_input && channel >= data->num_temp_limit)
+		return 0;
+
+	switch (attr) {
+	case hwmon_temp_input:
+	case hwmon_temp_alarm:
+		return 0444;
+	case hwmon_temp_min:
+	case hwmon_temp_max:
+		return 0644;
+	case hwmon_temp_type:
+		if (!(data->has_temp_type & BIT(channel)))
+			return 0;
+		return has_bank_sel(data) ? 0444 : 0644;
+	case hwmon_temp_offset:
+		return channel < data->num_temp_offset ? 0644 : 0;
+	case hwmon_temp_beep:
+		if (!data->has_beep)
+			return 0;
+		return channel ? 0444 : 0644;
+	default:
+		return 0;
 	}
+}
 
-	if (!(data->has_fan & BIT(i)))
+static umode_t it87_fan_is_visible(const struct it87_data *data, u32 attr,
+				   int channel)
+{
+	if (!(data->has_fan & BIT(channel)))
 		return 0;
 
-	if (a == 3) {				/* beep */
+	switch (attr) {
+	case hwmon_fan_input:
+	case hwmon_fan_alarm:
+		return 0444;
+	case hwmon_fan_min:
+		return 0644;
+	case hwmon_fan_beep:
 		if (!data->has_beep)
 			return 0;
 		/* first fan beep attribute is writable */
-		if (i == __ffs(data->has_fan))
-			return attr->mode | S_IWUSR;
+		return channel == __ffs(data->has_fan) ? 0644 : 0444;
+	case hwmon_fan_div:
+		if (channel >= NUM_FAN_DIV || has_16bit_fans(data))
+			return 0;
+		return 0644;
+	default:
+		return 0;
 	}
+}
 
-	if (a == 4 && has_16bit_fans(data))	/* divisor */
+static umode_t it87_pwm_is_visible(const struct it87_data *data, u32 attr,
+				   int channel)
+{
+	if (!(data->has_pwm & BIT(channel)))
 		return 0;
 
-	return attr->mode;
+	switch (attr) {
+	case hwmon_pwm_enable:
+	case hwmon_pwm_input:
+		return 0644;
+	case hwmon_pwm_freq:
+		/* pwm2_freq is writable with two pwm frequency selects */
+		if (channel == 0 || (channel == 1 && has_pwm_freq2(data)))
+			return 0644;
+		return 0444;
+	case hwmon_pwm_auto_channels_temp:
+		/* only writable if auto pwm is supported */
+		if (has_old_autopwm(data) || has_newer_autopwm(data))
+			return 0644;
+		return 0444;
+	default:
+		return 0;
+	}
 }
 
-static struct attribute *it87_attributes_fan[] = {
-	&sensor_dev_attr_fan1_input.dev_attr.attr,
-	&sensor_dev_attr_fan1_min.dev_attr.attr,
-	&sensor_dev_attr_fan1_alarm.dev_attr.attr,
-	&sensor_dev_attr_fan1_beep.dev_attr.attr,	/* 3 */
-	&sensor_dev_attr_fan1_div.dev_attr.attr,	/* 4 */
-
-	&sensor_dev_attr_fan2_input.dev_attr.attr,
-	&sensor_dev_attr_fan2_min.dev_attr.attr,
-	&sensor_dev_attr_fan2_alarm.dev_attr.attr,
-	&sensor_dev_attr_fan2_beep.dev_attr.attr,
-	&sensor_dev_attr_fan2_div.dev_attr.attr,	/* 9 */
-
-	&sensor_dev_attr_fan3_input.dev_attr.attr,
-	&sensor_dev_attr_fan3_min.dev_attr.attr,
-	&sensor_dev_attr_fan3_alarm.dev_attr.attr,
-	&sensor_dev_attr_fan3_beep.dev_attr.attr,
-	&sensor_dev_attr_fan3_div.dev_attr.attr,	/* 14 */
-
-	&sensor_dev_attr_fan4_input.dev_attr.attr,	/* 15 */
-	&sensor_dev_attr_fan4_min.dev_attr.attr,
-	&sensor_dev_attr_fan4_alarm.dev_attr.attr,
-	&sensor_dev_attr_fan4_beep.dev_attr.attr,
-
-	&sensor_dev_attr_fan5_input.dev_attr.attr,	/* 19 */
-	&sensor_dev_attr_fan5_min.dev_attr.attr,
-	&sensor_dev_attr_fan5_alarm.dev_attr.attr,
-	&sensor_dev_attr_fan5_beep.dev_attr.attr,
-
-	&sensor_dev_attr_fan6_input.dev_attr.attr,	/* 23 */
-	&sensor_dev_attr_fan6_min.dev_attr.attr,
-	&sensor_dev_attr_fan6_alarm.dev_attr.attr,
-	&sensor_dev_attr_fan6_beep.dev_attr.attr,
-	NULL
-};
-
-static const struct attribute_group it87_group_fan = {
-	.attrs = it87_attributes_fan,
-	.is_visible = it87_fan_is_visible,
-};
-
-static umode_t it87_pwm_is_visible(struct kobject *kobj,
-				   struct attribute *attr, int index)
+static umode_t it87_is_visible(const void *drvdata,
+			       enum hwmon_sensor_types type, u32 attr,
+			       int channel)
 {
-	struct device *dev = kobj_to_dev(kobj);
-	struct it87_data *data = dev_get_drvdata(dev);
-	int i = index / 4;	/* pwm index */
-	int a = index % 4;	/* attribute index */
-
-	if (!(data->has_pwm & BIT(i)))
+	const struct it87_data *data = drvdata;
+
+	switch (type) {
+	case hwmon_chip:
+		if (attr == hwmon_chip_update_interval)
+			return 0644;
+		return 0444;
+	case hwmon_in:
+		return it87_in_is_visible(data, attr, channel);
+	case hwmon_temp:
+		return it87_temp_is_visible(data, attr, channel);
+	case hwmon_fan:
+		return it87_fan_is_visible(data, attr, channel);
+	case hwmon_pwm:
+		return it87_pwm_is_visible(data, attr, channel);
+	case hwmon_intrusion:
+		return 0644;
+	default:
 		return 0;
-
-	/* pwmX_auto_channels_temp is only writable if auto pwm is supported */
-	if (a == 3 && (has_old_autopwm(data) || has_newer_autopwm(data)))
-		return attr->mode | S_IWUSR;
-
-	/* pwm2_freq is writable if there are two pwm frequency selects */
-	if (has_pwm_freq2(data) && i == 1 && a == 2)
-		return attr->mode | S_IWUSR;
-
-	return attr->mode;
+	}
 }
 
-static struct attribute *it87_attributes_pwm[] = {
-	&sensor_dev_attr_pwm1_enable.dev_attr.attr,
-	&sensor_dev_attr_pwm1.dev_attr.attr,
-	&sensor_dev_attr_pwm1_freq.dev_attr.attr,
-	&sensor_dev_attr_pwm1_auto_channels_temp.dev_attr.attr,
-
-	&sensor_dev_attr_pwm2_enable.dev_attr.attr,
-	&sensor_dev_attr_pwm2.dev_attr.attr,
-	&sensor_dev_attr_pwm2_freq.dev_attr.attr,
-	&sensor_dev_attr_pwm2_auto_channels_temp.dev_attr.attr,
-
-	&sensor_dev_attr_pwm3_enable.dev_attr.attr,
-	&sensor_dev_attr_pwm3.dev_attr.attr,
-	&sensor_dev_attr_pwm3_freq.dev_attr.attr,
-	&sensor_dev_attr_pwm3_auto_channels_temp.dev_attr.attr,
-
-	&sensor_dev_attr_pwm4_enable.dev_attr.attr,
-	&sensor_dev_attr_pwm4.dev_attr.attr,
-	&sensor_dev_attr_pwm4_freq.dev_attr.attr,
-	&sensor_dev_attr_pwm4_auto_channels_temp.dev_attr.attr,
-
-	&sensor_dev_attr_pwm5_enable.dev_attr.attr,
-	&sensor_dev_attr_pwm5.dev_attr.attr,
-	&sensor_dev_attr_pwm5_freq.dev_attr.attr,
-	&sensor_dev_attr_pwm5_auto_channels_temp.dev_attr.attr,
-
-	&sensor_dev_attr_pwm6_enable.dev_attr.attr,
-	&sensor_dev_attr_pwm6.dev_attr.attr,
-	&sensor_dev_attr_pwm6_freq.dev_attr.attr,
-	&sensor_dev_attr_pwm6_auto_channels_temp.dev_attr.attr,
-
+static const struct hwmon_channel_info *it87_info[] = {
+	HWMON_CHANNEL_INFO(chip,
+			   HWMON_C_UPDATE_INTERVAL | HWMON_C_ALARMS),
+	HWMON_CHANNEL_INFO(in,
+			   HWMON_I_INPUT | HWMON_I_MIN | HWMON_I_MAX |
+			   HWMON_I_ALARM | HWMON_I_BEEP | HWMON_I_LABEL,
+			   HWMON_I_INPUT | HWMON_I_MIN | HWMON_I_MAX |
+			   HWMON_I_ALARM | HWMON_I_BEEP | HWMON_I_LABEL,
+			   HWMON_I_INPUT | HWMON_I_MIN | HWMON_I_MAX |
+			   HWMON_I_ALARM | HWMON_I_BEEP | HWMON_I_LABEL,
+			   HWMON_I_INPUT | HWMON_I_MIN | HWMON_I_MAX |
+			   HWMON_I_ALARM | HWMON_I_BEEP | HWMON_I_LABEL,
+			   HWMON_I_INPUT | HWMON_I_MIN | HWMON_I_MAX |
+			   HWMON_I_ALARM | HWMON_I_BEEP | HWMON_I_LABEL,
+			   HWMON_I_INPUT | HWMON_I_MIN | HWMON_I_MAX |
+			   HWMON_I_ALARM | HWMON_I_BEEP | HWMON_I_LABEL,
+			   HWMON_I_INPUT | HWMON_I_MIN | HWMON_I_MAX |
+			   HWMON_I_ALARM | HWMON_I_BEEP | HWMON_I_LABEL,
+			   HWMON_I_INPUT | HWMON_I_MIN | HWMON_I_MAX |
+			   HWMON_I_ALARM | HWMON_I_BEEP | HWMON_I_LABEL,
+			   HWMON_I_INPUT | HWMON_I_LABEL,
+			   HWMON_I_INPUT | HWMON_I_LABEL,
+			   HWMON_I_INPUT,
+			   HWMON_I_INPUT,
+			   HWMON_I_INPUT),
+	HWMON_CHANNEL_INFO(temp,
+			   HWMON_T_INPUT | HWMON_T_MIN | HWMON_T_MAX |
+			   HWMON_T_TYPE | HWMON_T_ALARM | HWMON_T_OFFSET |
+			   HWMON_T_BEEP,
+			   HWMON_T_INPUT | HWMON_T_MIN | HWMON_T_MAX |
+			   HWMON_T_TYPE | HWMON_T_ALARM | HWMON_T_OFFSET |
+			   HWMON_T_BEEP,
+			   HWMON_T_INPUT | HWMON_T_MIN | HWMON_T_MAX |
+			   HWMON_T_TYPE | HWMON_T_ALARM | HWMON_T_OFFSET |
+			   HWMON_T_BEEP,
+			   HWMON_T_INPUT | HWMON_T_MIN | HWMON_T_MAX |
+			   HWMON_T_TYPE | HWMON_T_ALARM | HWMON_T_OFFSET |
+			   HWMON_T_BEEP,
+			   HWMON_T_INPUT | HWMON_T_MIN | HWMON_T_MAX |
+			   HWMON_T_TYPE | HWMON_T_ALARM | HWMON_T_OFFSET |
+			   HWMON_T_BEEP,
+			   HWMON_T_INPUT | HWMON_T_MIN | HWMON_T_MAX |
+			   HWMON_T_TYPE | HWMON_T_ALARM | HWMON_T_OFFSET |
+			   HWMON_T_BEEP),
+	HWMON_CHANNEL_INFO(fan,
+			   HWMON_F_INPUT | HWMON_F_MIN | HWMON_F_ALARM |
+			   HWMON_F_BEEP | HWMON_F_DIV,
+			   HWMON_F_INPUT | HWMON_F_MIN | HWMON_F_ALARM |
+			   HWMON_F_BEEP | HWMON_F_DIV,
+			   HWMON_F_INPUT | HWMON_F_MIN | HWMON_F_ALARM |
+			   HWMON_F_BEEP | HWMON_F_DIV,
+			   HWMON_F_INPUT | HWMON_F_MIN | HWMON_F_ALARM |
+			   HWMON_F_BEEP,
+			   HWMON_F_INPUT | HWMON_F_MIN | HWMON_F_ALARM |
+			   HWMON_F_BEEP,
+			   HWMON_F_INPUT | HWMON_F_MIN | HWMON_F_ALARM |
+			   HWMON_F_BEEP),
+	HWMON_CHANNEL_INFO(pwm,
+			   HWMON_PWM_INPUT | HWMON_PWM_ENABLE |
+			   HWMON_PWM_FREQ | HWMON_PWM_AUTO_CHANNELS_TEMP,
+			   HWMON_PWM_INPUT | HWMON_PWM_ENABLE |
+			   HWMON_PWM_FREQ | HWMON_PWM_AUTO_CHANNELS_TEMP,
+			   HWMON_PWM_INPUT | HWMON_PWM_ENABLE |
+			   HWMON_PWM_FREQ | HWMON_PWM_AUTO_CHANNELS_TEMP,
+			   HWMON_PWM_INPUT | HWMON_PWM_ENABLE |
+			   HWMON_PWM_FREQ | HWMON_PWM_AUTO_CHANNELS_TEMP,
+			   HWMON_PWM_INPUT | HWMON_PWM_ENABLE |
+			   HWMON_PWM_FREQ | HWMON_PWM_AUTO_CHANNELS_TEMP,
+			   HWMON_PWM_INPUT | HWMON_PWM_ENABLE |
+			   HWMON_PWM_FREQ | HWMON_PWM_AUTO_CHANNELS_TEMP),
+	HWMON_CHANNEL_INFO(intrusion, HWMON_INTRUSION_ALARM),
 	NULL
 };
 
-static const struct attribute_group it87_group_pwm = {
-	.attrs = it87_attributes_pwm,
-	.is_visible = it87_pwm_is_visible,
+static const struct hwmon_ops it87_hwmon_ops = {
+	.is_visible = it87_is_visible,
+	.read = it87_read,
+	.read_string = it87_read_string,
+	.write = it87_write,
+};
+
+static const struct hwmon_chip_info it87_chip_info = {
+	.ops = &it87_hwmon_ops,
+	.info = it87_info,
 };
 
 static umode_t it87_auto_pwm_is_visible(struct kobject *kobj,
@@ -3308,6 +4484,16 @@ static umode_t it87_auto_pwm_is_visible(struct kobject *kobj,
 	int i = index / 11;	/* pwm index */
 	int a = index % 11;	/* attribute index */
 
+	if (index >= 51) {	/* pwmX_auto_points, pwmX_curve */
+		i = (index - 51) % 6;
+		if (!(data->has_pwm & BIT(i)))
+			return 0;
+		/* old style auto pwm only has trip points on pwm1..3 */
+		if (has_old_autopwm(data) && i >= 3)
+			return 0;
+		return attr->mode;
+	}
+
 	if (index >= 33) {	/* pwm 4..6 */
 		i = (index - 33) / 6 + 3;
 		a = (index - 33) % 6 + 4;
@@ -3388,6 +4574,20 @@ static struct attribute *it87_attributes_auto_pwm[] = {
 	&sensor_dev_attr_pwm6_auto_start.dev_attr.attr,
 	&sensor_dev_attr_pwm6_auto_slope.dev_attr.attr,
 
+	&sensor_dev_attr_pwm1_auto_points.dev_attr.attr,	/* 51 */
+	&sensor_dev_attr_pwm2_auto_points.dev_attr.attr,
+	&sensor_dev_attr_pwm3_auto_points.dev_attr.attr,
+	&sensor_dev_attr_pwm4_auto_points.dev_attr.attr,
+	&sensor_dev_attr_pwm5_auto_points.dev_attr.attr,
+	&sensor_dev_attr_pwm6_auto_points.dev_attr.attr,
+
+	&sensor_dev_attr_pwm1_curve.dev_attr.attr,	/* 57 */
+	&sensor_dev_attr_pwm2_curve.dev_attr.attr,
+	&sensor_dev_attr_pwm3_curve.dev_attr.attr,
+	&sensor_dev_attr_pwm4_curve.dev_attr.attr,
+	&sensor_dev_attr_pwm5_curve.dev_attr.attr,
+	&sensor_dev_attr_pwm6_curve.dev_attr.attr,
+
 	NULL,
 };
 
@@ -3421,6 +4621,172 @@ static const struct attribute_group it87_group_gpled_blink = {
     .is_visible = it87_gpled_blink_is_visible,
 };
 
+/* Settings of the fan control loop, see it87_fan_loop_step() */
+static ssize_t show_fan_loop(struct device *dev, struct device_attribute *attr,
+			     char *buf)
+{
+	struct it87_data *data = dev_get_drvdata(dev);
+	struct sensor_device_attribute_2 *sensor_attr =
+			to_sensor_dev_attr_2(attr);
+	struct it87_fan_loop *loop = &data->fan_loop[sensor_attr->nr];
+	int val;
+
+	mutex_lock(&data->update_lock);
+	switch (sensor_attr->index) {
+	case 0:
+		val = loop->target;
+		break;
+	case 1:
+		val = loop->min;
+		break;
+	case 2:
+		val = loop->max;
+		break;
+	default:
+		val = loop->step;
+		break;
+	}
+	mutex_unlock(&data->update_lock);
+
+	return sprintf(buf, "%d\n", val);
+}
+
+static ssize_t set_fan_loop(struct device *dev, struct device_attribute *attr,
+			    const char *buf, size_t count)
+{
+	struct it87_data *data = dev_get_drvdata(dev);
+	struct sensor_device_attribute_2 *sensor_attr =
+			to_sensor_dev_attr_2(attr);
+	struct it87_fan_loop *loop = &data->fan_loop[sensor_attr->nr];
+	long val;
+	int err = 0;
+
+	if (kstrtol(buf, 10, &val) < 0)
+		return -EINVAL;
+
+	mutex_lock(&data->update_lock);
+	switch (sensor_attr->index) {
+	case 0:
+		loop->target = clamp_val(val, -128000, 127000);
+		break;
+	case 1:
+		if (val < 0 || val > loop->max)
+			err = -EINVAL;
+		else
+			loop->min = val;
+		break;
+	case 2:
+		if (val < loop->min || val > 255)
+			err = -EINVAL;
+		else
+			loop->max = val;
+		break;
+	default:
+		if (val < 0 || val > 255)
+			err = -EINVAL;
+		else
+			loop->step = val;
+		break;
+	}
+	mutex_unlock(&data->update_lock);
+
+	return err ? err : count;
+}
+
+static SENSOR_DEVICE_ATTR_2(pwm1_loop_target, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 0, 0);
+static SENSOR_DEVICE_ATTR_2(pwm1_loop_min, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 0, 1);
+static SENSOR_DEVICE_ATTR_2(pwm1_loop_max, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 0, 2);
+static SENSOR_DEVICE_ATTR_2(pwm1_loop_step, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 0, 3);
+static SENSOR_DEVICE_ATTR_2(pwm2_loop_target, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 1, 0);
+static SENSOR_DEVICE_ATTR_2(pwm2_loop_min, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 1, 1);
+static SENSOR_DEVICE_ATTR_2(pwm2_loop_max, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 1, 2);
+static SENSOR_DEVICE_ATTR_2(pwm2_loop_step, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 1, 3);
+static SENSOR_DEVICE_ATTR_2(pwm3_loop_target, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 2, 0);
+static SENSOR_DEVICE_ATTR_2(pwm3_loop_min, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 2, 1);
+static SENSOR_DEVICE_ATTR_2(pwm3_loop_max, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 2, 2);
+static SENSOR_DEVICE_ATTR_2(pwm3_loop_step, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 2, 3);
+static SENSOR_DEVICE_ATTR_2(pwm4_loop_target, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 3, 0);
+static SENSOR_DEVICE_ATTR_2(pwm4_loop_min, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 3, 1);
+static SENSOR_DEVICE_ATTR_2(pwm4_loop_max, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 3, 2);
+static SENSOR_DEVICE_ATTR_2(pwm4_loop_step, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 3, 3);
+static SENSOR_DEVICE_ATTR_2(pwm5_loop_target, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 4, 0);
+static SENSOR_DEVICE_ATTR_2(pwm5_loop_min, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 4, 1);
+static SENSOR_DEVICE_ATTR_2(pwm5_loop_max, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 4, 2);
+static SENSOR_DEVICE_ATTR_2(pwm5_loop_step, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 4, 3);
+static SENSOR_DEVICE_ATTR_2(pwm6_loop_target, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 5, 0);
+static SENSOR_DEVICE_ATTR_2(pwm6_loop_min, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 5, 1);
+static SENSOR_DEVICE_ATTR_2(pwm6_loop_max, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 5, 2);
+static SENSOR_DEVICE_ATTR_2(pwm6_loop_step, S_IRUGO | S_IWUSR,
+			    show_fan_loop, set_fan_loop, 5, 3);
+
+static umode_t it87_fan_loop_is_visible(struct kobject *kobj,
+					struct attribute *attr, int index)
+{
+	struct device *dev = kobj_to_dev(kobj);
+	struct it87_data *data = dev_get_drvdata(dev);
+
+	if (!(data->has_pwm & BIT(index / 4)))
+		return 0;
+
+	return attr->mode;
+}
+
+static struct attribute *it87_attributes_fan_loop[] = {
+	&sensor_dev_attr_pwm1_loop_target.dev_attr.attr,
+	&sensor_dev_attr_pwm1_loop_min.dev_attr.attr,
+	&sensor_dev_attr_pwm1_loop_max.dev_attr.attr,
+	&sensor_dev_attr_pwm1_loop_step.dev_attr.attr,
+	&sensor_dev_attr_pwm2_loop_target.dev_attr.attr,
+	&sensor_dev_attr_pwm2_loop_min.dev_attr.attr,
+	&sensor_dev_attr_pwm2_loop_max.dev_attr.attr,
+	&sensor_dev_attr_pwm2_loop_step.dev_attr.attr,
+	&sensor_dev_attr_pwm3_loop_target.dev_attr.attr,
+	&sensor_dev_attr_pwm3_loop_min.dev_attr.attr,
+	&sensor_dev_attr_pwm3_loop_max.dev_attr.attr,
+	&sensor_dev_attr_pwm3_loop_step.dev_attr.attr,
+	&sensor_dev_attr_pwm4_loop_target.dev_attr.attr,
+	&sensor_dev_attr_pwm4_loop_min.dev_attr.attr,
+	&sensor_dev_attr_pwm4_loop_max.dev_attr.attr,
+	&sensor_dev_attr_pwm4_loop_step.dev_attr.attr,
+	&sensor_dev_attr_pwm5_loop_target.dev_attr.attr,
+	&sensor_dev_attr_pwm5_loop_min.dev_attr.attr,
+	&sensor_dev_attr_pwm5_loop_max.dev_attr.attr,
+	&sensor_dev_attr_pwm5_loop_step.dev_attr.attr,
+	&sensor_dev_attr_pwm6_loop_target.dev_attr.attr,
+	&sensor_dev_attr_pwm6_loop_min.dev_attr.attr,
+	&sensor_dev_attr_pwm6_loop_max.dev_attr.attr,
+	&sensor_dev_attr_pwm6_loop_step.dev_attr.attr,
+	NULL
+};
+
+static const struct attribute_group it87_group_fan_loop = {
+	.attrs = it87_attributes_fan_loop,
+	.is_visible = it87_fan_loop_is_visible,
+};
+
 /* SuperIO detection - will change isa_address if a chip is found */
 static int __init it87_find(int sioaddr, unsigned short *address,
 			    phys_addr_t *mmio_address,
@@ -4099,6 +5465,113 @@ exit:
 	return err;
 }
 
+static void it87_init_access(struct it87_data *data)
+{
+	if (data->mmio) {
+		data->read = it87_mmio_read;
+		data->write = it87_mmio_write;
+	} else if (has_bank_sel(data)) {
+		data->read = it87_io_read;
+		data->write = it87_io_write;
+	} else {
+		data->read = _it87_io_read;
+		data->write = _it87_io_write;
+	}
+}
+
+static int it87_request_io(struct platform_device *pdev,
+			   struct it87_data *data)
+{
+	struct device *dev = &pdev->dev;
+	struct resource *res;
+
+	res = platform_get_resource(pdev, IORESOURCE_IO, 0);
+	if (!res)
+		return -ENODEV;
+
+	if (!devm_request_region(dev, res->start, IT87_EC_EXTENT, DRVNAME)) {
+		dev_err(dev, "Failed to request region %pR\n", res);
+		return -EBUSY;
+	}
+	data->addr = res->start;
+	return 0;
+}
+
+/*
+ * The MMIO window is only usable if the firmware enabled its decoding.
+ * Check that it returns the chip ID, otherwise fall back to port I/O.
+ * Must be called with SMBus accesses disabled.
+ */
+static int it87_check_mmio(struct platform_device *pdev,
+			   struct it87_data *data)
+{
+	struct resource *res;
+	int err;
+
+	if (!data->mmio || it87_mmio_read(data, IT87_REG_CHIPID) == 0x90)
+		return 0;
+
+	dev_info(&pdev->dev, "MMIO not responding, using port I/O\n");
+	smbus_enable(data);
+
+	/* Unmap and release the window rather than hold it until removal */
+	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+	devm_iounmap(&pdev->dev, data->mmio);
+	devm_release_mem_region(&pdev->dev, res->start, resource_size(res));
+	data->mmio = NULL;
+
+	err = it87_request_io(pdev, data);
+	if (err)
+		return err;
+	it87_init_access(data);
+	return smbus_disable(data);
+}
+
+#define IT87_ACCESS_SAMPLES	16
+
+static u32 it87_time_reads(struct it87_data *data,
+			   int (*read)(struct it87_data *, u16))
+{
+	u64 start = ktime_get_ns();
+	int i;
+
+	for (i = 0; i < IT87_ACCESS_SAMPLES; i++)
+		read(data, IT87_REG_CHIPID);
+	return div_u64(ktime_get_ns() - start, IT87_ACCESS_SAMPLES);
+}
+
+/*
+ * Time a register read over MMIO and over port I/O, whichever is usable,
+ * so that both can be compared on the same machine. The I/O ports are not
+ * claimed while MMIO is used, so they are only borrowed for the
+ * measurement.
+ * Must be called with SMBus accesses disabled.
+ */
+static void it87_measure_access(struct platform_device *pdev,
+				struct it87_data *data)
+{
+	struct resource *res;
+
+	if (!data->mmio) {
+		data->io_access_ns = it87_time_reads(data, data->read);
+		data->access_ns = data->io_access_ns;
+		return;
+	}
+
+	data->mmio_access_ns = it87_time_reads(data, data->read);
+	data->access_ns = data->mmio_access_ns;
+
+	res = platform_get_resource(pdev, IORESOURCE_IO, 0);
+	if (!res || !request_region(res->start, IT87_EC_EXTENT, DRVNAME))
+		return;
+	data->addr = res->start;
+	data->io_access_ns = it87_time_reads(data, has_bank_sel(data) ?
+					     it87_io_read : _it87_io_read);
+	it87_io_restore_bank(data);
+	data->addr = 0;
+	release_region(res->start, IT87_EC_EXTENT);
+}
+
 static void it87_init_regs(struct platform_device *pdev)
 {
 	struct it87_data *data = platform_get_drvdata(pdev);
@@ -4163,16 +5636,7 @@ static void it87_init_regs(struct platform_device *pdev)
 			break;
 	}
 
-	if (data->mmio) {
-		data->read = it87_mmio_read;
-		data->write = it87_mmio_write;
-	} else if (has_bank_sel(data)) {
-		data->read = it87_io_read;
-		data->write = it87_io_write;
-	} else {
-		data->read = _it87_io_read;
-		data->write = _it87_io_write;
-	}
+	it87_init_access(data);
 }
 
 /* Called when we have found a new IT87. */
@@ -4322,6 +5786,113 @@ static void it87_init_device(struct platform_device *pdev)
 			(update_vbat ? 0x41 : 0x01));
 }
 
+static struct dentry *it87_debugfs_root;
+
+static void it87_remove_debugfs(void *debugfs)
+{
+	debugfs_remove_recursive(debugfs);
+}
+
+/* Writing to "refresh" forces a register cache update, for benchmarking */
+static int it87_debugfs_refresh(void *dev, u64 val)
+{
+	struct it87_data *data = dev_get_drvdata(dev);
+
+	mutex_lock(&data->update_lock);
+	it87_invalidate(data);
+	mutex_unlock(&data->update_lock);
+
+	return PTR_ERR_OR_ZERO(it87_update_device(dev, IT87_ALL_SLICES));
+}
+DEFINE_DEBUGFS_ATTRIBUTE(it87_refresh_fops, NULL, it87_debugfs_refresh,
+			 "%llu\n");
+
+static int it87_access_path_show(struct seq_file *s, void *unused)
+{
+	struct it87_data *data = s->private;
+
+	seq_puts(s, data->mmio ? "mmio\n" : "io\n");
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(it87_access_path);
+
+/* Port access statistics, to measure the cost of register accesses */
+static int it87_init_debugfs(struct device *dev, struct it87_data *data)
+{
+	data->debugfs = debugfs_create_dir(dev_name(dev), it87_debugfs_root);
+	debugfs_create_u32("port_cycles", 0444, data->debugfs,
+			   &data->port_cycles);
+	debugfs_create_u32("bank_switches", 0444, data->debugfs,
+			   &data->bank_switches);
+	debugfs_create_u32("smbus_toggles", 0444, data->debugfs,
+			   &data->smbus_toggles);
+	debugfs_create_u32("refreshes", 0444, data->debugfs,
+			   &data->refreshes);
+	debugfs_create_u32("refresh_port_cycles", 0444, data->debugfs,
+			   &data->refresh_port_cycles);
+	debugfs_create_u32("refresh_bank_switches", 0444, data->debugfs,
+			   &data->refresh_bank_switches);
+	debugfs_create_u64("refresh_ns", 0444, data->debugfs,
+			   &data->refresh_ns);
+	debugfs_create_file_unsafe("refresh", 0200, data->debugfs, dev,
+				   &it87_refresh_fops);
+	debugfs_create_file("access_path", 0444, data->debugfs, data,
+			    &it87_access_path_fops);
+	debugfs_create_u32("access_ns", 0444, data->debugfs,
+			   &data->access_ns);
+	debugfs_create_u32("mmio_access_ns", 0444, data->debugfs,
+			   &data->mmio_access_ns);
+	debugfs_create_u32("io_access_ns", 0444, data->debugfs,
+			   &data->io_access_ns);
+
+	return devm_add_action_or_reset(dev, it87_remove_debugfs,
+					data->debugfs);
+}
+
+static void it87_sampler_work(struct work_struct *work)
+{
+	struct it87_data *data = container_of(to_delayed_work(work),
+					      struct it87_data, sampler);
+
+	/* On error, keep the last sample and try again on the next tick */
+	it87_update_device(data->dev, IT87_ALL_SLICES);
+	schedule_delayed_work(&data->sampler, data->sample_period);
+}
+
+static void it87_stop_sampler(void *data)
+{
+	cancel_delayed_work_sync(&((struct it87_data *)data)->sampler);
+}
+
+/*
+ * Refresh measured values from a delayed work, so that hwmon readers only
+ * copy the published sample and never wait for the chip or each other.
+ */
+static int it87_init_sampler(struct device *dev, struct it87_data *data)
+{
+	struct it87_data *ret;
+
+	if (!sample_interval)
+		return 0;
+
+	seqcount_init(&data->sample_seq);
+	INIT_DELAYED_WORK(&data->sampler, it87_sampler_work);
+	data->sample_period = msecs_to_jiffies(sample_interval);
+
+	/* Publish a first sample before the hwmon device shows up */
+	mutex_lock(&data->update_lock);
+	it87_invalidate(data);
+	mutex_unlock(&data->update_lock);
+	ret = it87_update_device(dev, IT87_ALL_SLICES);
+	if (IS_ERR(ret)) {
+		data->sample_period = 0;
+		return PTR_ERR(ret);
+	}
+
+	schedule_delayed_work(&data->sampler, data->sample_period);
+	return devm_add_action_or_reset(dev, it87_stop_sampler, data);
+}
+
 /* Return 1 if and only if the PWM interface is safe to use */
 static int it87_check_pwm(struct device *dev)
 {
@@ -4345,27 +5916,28 @@ static int it87_probe(struct platform_device *pdev)
 	struct it87_sio_data *sio_data = dev_get_platdata(dev);
 	int enable_pwm_interface;
 	struct device *hwmon_dev;
-	int err, group_idx;
+	int err, group_idx, i;
 
 	data = devm_kzalloc(dev, sizeof(struct it87_data), GFP_KERNEL);
 	if (!data)
 		return -ENOMEM;
 
-	res = platform_get_resource(pdev, IORESOURCE_IO, 0);
+	/* Prefer MMIO, the I/O ports are registered as a fallback */
+	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
 	if (res) {
-		if (!devm_request_region(dev, res->start, IT87_EC_EXTENT,
-					DRVNAME)) {
-			dev_err(dev, "Failed to request region %pR\n", res);
-			return -EBUSY;
-		}
-	} else {
-		res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
 		data->mmio = devm_ioremap_resource(dev, res);
-		if (IS_ERR(data->mmio))
-			return PTR_ERR(data->mmio);
+		if (IS_ERR(data->mmio)) {
+			dev_info(dev, "Failed to map %pR, using port I/O\n",
+				 res);
+			data->mmio = NULL;
+		}
+	}
+	if (!data->mmio) {
+		err = it87_request_io(pdev, data);
+		if (err)
+			return err;
 	}
 
-	data->addr = res->start;
 	data->sioaddr = sio_data->sioaddr;
 	data->type = sio_data->type;
 	data->smbus_bitmap = sio_data->smbus_bitmap;
@@ -4402,8 +5974,10 @@ static int it87_probe(struct platform_device *pdev)
 	}
 
 	platform_set_drvdata(pdev, data);
+	data->dev = dev;
 
 	mutex_init(&data->update_lock);
+	data->update_interval = IT87_UPDATE_INTERVAL;
 
 	/* Initialize register pointers */
 	it87_init_regs(pdev);
@@ -4423,6 +5997,10 @@ static int it87_probe(struct platform_device *pdev)
 	if (err)
 		return err;
 
+	err = it87_check_mmio(pdev, data);
+	if (err)
+		return err;
+
 	/* Now, we do the remaining detection. */
 	if ((data->read(data, IT87_REG_CONFIG) & 0x80) ||
 			data->read(data, IT87_REG_CHIPID) != 0x90) {
@@ -4430,6 +6008,8 @@ static int it87_probe(struct platform_device *pdev)
 		return -ENODEV;
 	}
 
+	it87_measure_access(pdev, data);
+
 	/* Check PWM configuration */
 	enable_pwm_interface = it87_check_pwm(dev);
 
@@ -4492,6 +6072,11 @@ static int it87_probe(struct platform_device *pdev)
 	/* Initialize the IT87 chip */
 	it87_init_device(pdev);
 
+	for (i = 0; i < NUM_TEMP; i++) {
+		if ((data->has_temp & BIT(i)) && get_temp_type(data, i))
+			data->has_temp_type |= BIT(i);
+	}
+
 	smbus_enable(data);
 
 	if (!sio_data->skip_vid) {
@@ -4503,11 +6088,9 @@ static int it87_probe(struct platform_device *pdev)
 
 	/* Prepare for sysfs hooks */
 	data->groups[0] = &it87_group;
-	data->groups[1] = &it87_group_in;
-	data->groups[2] = &it87_group_temp;
-	data->groups[3] = &it87_group_fan;
+	platform_set_drvdata(pdev, data);
 
-	group_idx = 4;
+	group_idx = 1;
 	if(data->features & FEAT_BLINK_CTRL) {
 		data->groups[group_idx] = &it87_group_gpled_blink;
 		++group_idx;
@@ -4517,15 +6100,34 @@ static int it87_probe(struct platform_device *pdev)
 		data->has_pwm = BIT(ARRAY_SIZE(IT87_REG_PWM)) - 1;
 		data->has_pwm &= ~sio_data->skip_pwm;
 
-		data->groups[group_idx] = &it87_group_pwm;
-		++group_idx;
 		if (has_old_autopwm(data) || has_newer_autopwm(data))
-			data->groups[group_idx] = &it87_group_auto_pwm;
+			data->groups[group_idx++] = &it87_group_auto_pwm;
+		data->groups[group_idx] = &it87_group_fan_loop;
 	}
 
-	hwmon_dev = devm_hwmon_device_register_with_groups(dev,
+	err = it87_init_snapshot(dev, data);
+	if (err)
+		return err;
+
+	err = it87_init_debugfs(dev, data);
+	if (err)
+		return err;
+
+	err = it87_init_sampler(dev, data);
+	if (err)
+		return err;
+
+	err = it87_init_fan_loop(dev, data);
+	if (err)
+		return err;
+
+	err = it87_init_cooling(dev, data);
+	if (err)
+		return err;
+
+	hwmon_dev = devm_hwmon_device_register_with_info(dev,
 					it87_devices[sio_data->type].name,
-					data, data->groups);
+					data, &it87_chip_info, data->groups);
 	return PTR_ERR_OR_ZERO(hwmon_dev);
 }
 
@@ -4541,32 +6143,37 @@ static int __init it87_device_add(int index, unsigned short address,
 				  const struct it87_sio_data *sio_data)
 {
 	struct platform_device *pdev;
-	struct resource res = {
-		.name  = DRVNAME,
+	struct resource res[2] = {
+		{ .name = DRVNAME },
+		{ .name = DRVNAME },
 	};
+	int nres = 0;
 	int err;
 
+	/* MMIO is preferred, the I/O ports are kept as a fallback */
 	if (mmio_address) {
-		res.start = mmio_address;
-		res.end  = mmio_address + 0x400 - 1;
-		res.flags = IORESOURCE_MEM;
-	} else {
-		res.start = address + IT87_EC_OFFSET;
-		res.end  = address + IT87_EC_OFFSET + IT87_EC_EXTENT - 1;
-		res.flags = IORESOURCE_IO;
+		res[0].start = mmio_address;
+		res[0].end  = mmio_address + 0x400 - 1;
+		res[0].flags = IORESOURCE_MEM;
+		err = acpi_check_resource_conflict(&res[0]);
+		if (!err || ignore_resource_conflict)
+			nres++;
 	}
 
-	err = acpi_check_resource_conflict(&res);
-	if (err) {
-		if (!ignore_resource_conflict)
-			return err;
-	}
+	res[nres].start = address + IT87_EC_OFFSET;
+	res[nres].end  = address + IT87_EC_OFFSET + IT87_EC_EXTENT - 1;
+	res[nres].flags = IORESOURCE_IO;
+	err = acpi_check_resource_conflict(&res[nres]);
+	if (!err || ignore_resource_conflict)
+		nres++;
+	else if (!nres)
+		return err;
 
 	pdev = platform_device_alloc(DRVNAME, address);
 	if (!pdev)
 		return -ENOMEM;
 
-	err = platform_device_add_resources(pdev, &res, 1);
+	err = platform_device_add_resources(pdev, res, nres);
 	if (err) {
 		pr_err("Device resource addition failed (%d)\n", err);
 		goto exit_device_put;
@@ -4707,6 +6314,8 @@ static int __init sm_it87_init(void)
 	if (err)
 		return err;
 
+	it87_debugfs_root = debugfs_create_dir(DRVNAME, NULL);
+
 	if (dmi_data && dmi_data->sio2_force_config)
 		__superio_enter(REG_4E);
 
@@ -4738,6 +6347,7 @@ exit_dev_unregister:
 	platform_device_unregister(it87_pdev[0]);
 exit_unregister:
 	platform_driver_unregister(&it87_driver);
+	debugfs_remove_recursive(it87_debugfs_root);
 	return err;
 }
 
@@ -4747,6 +6357,7 @@ static void __exit sm_it87_exit(void)
 	platform_device_unregister(it87_pdev[1]);
 	platform_device_unregister(it87_pdev[0]);
 	platform_driver_unregister(&it87_driver);
+	debugfs_remove_recursive(it87_debugfs_root);
 }
 
 MODULE_AUTHOR("Chris Gauthron, Jean Delvare <jdelvare@suse.de>");
@@ -8,28 +8,43 @@
 
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
+#include <linux/bitmap.h>
+#include <linux/blkdev.h>
 #include <linux/dmi.h>
 #include <linux/errno.h>
+#include <linux/firmware.h>
+#include <linux/gpio/consumer.h>
 #include <linux/gpio/driver.h>
 #include <linux/gpio/machine.h>
 #include <linux/gpio_keys.h>
 #include <linux/input.h>
 #include <linux/kernel.h>
 #include <linux/leds.h>
+#include <linux/libata.h>
 #include <linux/module.h>
 #include <linux/pci.h>
 #include <linux/platform_device.h>
+#include <linux/slab.h>
 #include <linux/version.h>
+#include <linux/workqueue.h>
+#include <scsi/scsi_host.h>
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 9, 0)
+#include <linux/part_stat.h> // part_stat_read() moved here from genhd.h
+#endif
 
 #define GPIO_IT87 "asustor_gpio_it87"
 #define GPIO_ICH "gpio_ich"
 #define GPIO_AS6100 "INT33FF:01"
 
+// LED trigger of the activity LED engine, see asustor_activity_work()
+#define ASUSTOR_DISK_TRIGGER "asustor-disk"
+
 #define DISK_ACT_LED(_name)                                                    \
 	{                                                                      \
 		.name            = _name ":green:disk",                        \
 		.default_state   = LEDS_GPIO_DEFSTATE_ON,                      \
-		.default_trigger = "disk-activity"                             \
+		.default_trigger = ASUSTOR_DISK_TRIGGER                        \
 	}
 #define DISK_ERR_LED(_name)                                                    \
 	{                                                                      \
@@ -38,8 +53,9 @@
 	}
 #define NVME_ACT_LED(_name)                                                    \
 	{                                                                      \
-		.name          = _name ":green:disk",                          \
-		.default_state = LEDS_GPIO_DEFSTATE_OFF                        \
+		.name            = _name ":green:disk",                        \
+		.default_state   = LEDS_GPIO_DEFSTATE_OFF,                     \
+		.default_trigger = ASUSTOR_DISK_TRIGGER                        \
 	}
 #define NVME_ERR_LED(_name)                                                    \
 	{                                                                      \
@@ -50,9 +66,9 @@
 // clang-format off
 
 // ASUSTOR Leds.
-// If ledtrig-blkdev ever lands, use that instead of disk-activity:
-// https://lore.kernel.org/linux-leds/20210819025053.222710-1-arequipeno@gmail.com/
-// Also, the "disk-activity" trigger does (currently?) *not* trigger for NVME devices.
+// The *:green:disk LEDs are driven per bay by the activity LED engine (see
+// asustor_activity_work()) instead of the global disk-activity trigger, which
+// also does (currently?) *not* trigger for NVME devices.
 static struct gpio_led asustor_leds[] = {
 	{ .name          = "power:front_panel",                             // 0
 	  .default_state = LEDS_GPIO_DEFSTATE_ON },
@@ -88,9 +104,83 @@ static struct gpio_led asustor_leds[] = {
 	{ .name = "red:side_outer", .default_state = LEDS_GPIO_DEFSTATE_ON }, // 25
 };
 
+// exported by asustor_it87.ko, looked up with symbol_get() like
+// asustor_gpio_it87_configure()
+extern int asustor_it87_gpled_blink(unsigned int gpio, unsigned long *delay_on,
+                                    unsigned long *delay_off);
+
+// global GPIO number of asustor_gpio_it87's line 0, -1 if it doesn't exist
+static int asustor_it87_gpio_base = -1;
+
+// IT87 lines currently blinking in hardware, and those waiting to be
+// unmapped from their blink controller by asustor_blink_stop_work().
+static DECLARE_BITMAP(asustor_hw_blinking, 64);
+static DECLARE_BITMAP(asustor_blink_stopping, 64);
+
+// Unmapping takes the IT87 lock, which sleeps, while leds-gpio also sets
+// the brightness from the softirq of the software blink timer.
+static void asustor_blink_stop(struct work_struct *work)
+{
+	int (*gpled_blink)(unsigned int, unsigned long *, unsigned long *);
+	unsigned int gpio;
+
+	gpled_blink = symbol_get(asustor_it87_gpled_blink);
+	for_each_set_bit(gpio, asustor_blink_stopping, 64) {
+		if (test_and_clear_bit(gpio, asustor_blink_stopping) &&
+		    gpled_blink)
+			gpled_blink(gpio, NULL, NULL);
+	}
+	if (gpled_blink)
+		symbol_put(asustor_it87_gpled_blink);
+}
+static DECLARE_WORK(asustor_blink_stop_work, asustor_blink_stop);
+
+// leds-gpio's blink_set hook: lets the IT87 blink its (active low) LEDs in
+// hardware, so e.g. the timer trigger needs no kernel timer. Returning an
+// error makes the LED core fall back to blinking in software, which then
+// calls this hook from atomic context, so only the blink path may sleep.
+static int asustor_gpio_blink_set(struct gpio_desc *desc, int state,
+                                  unsigned long *delay_on,
+                                  unsigned long *delay_off)
+{
+	int (*gpled_blink)(unsigned int, unsigned long *, unsigned long *);
+	int gpio = desc_to_gpio(desc) - asustor_it87_gpio_base;
+	int ret  = -EOPNOTSUPP;
+
+	if (state != GPIO_LED_BLINK) {
+		if (gpio >= 0 && gpio < 64 &&
+		    test_and_clear_bit(gpio, asustor_hw_blinking)) {
+			set_bit(gpio, asustor_blink_stopping);
+			schedule_work(&asustor_blink_stop_work);
+		}
+		if (gpiod_cansleep(desc))
+			gpiod_set_value_cansleep(desc, state);
+		else
+			gpiod_set_value(desc, state);
+		return 0;
+	}
+
+	if (asustor_it87_gpio_base < 0 || gpio < 0 || gpio >= 64 ||
+	    !gpiod_is_active_low(desc))
+		return ret;
+
+	// a pending unmap of this line must not undo the new blink mode
+	flush_work(&asustor_blink_stop_work);
+
+	gpled_blink = symbol_get(asustor_it87_gpled_blink);
+	if (gpled_blink) {
+		ret = gpled_blink(gpio, delay_on, delay_off);
+		symbol_put(asustor_it87_gpled_blink);
+	}
+	if (!ret)
+		set_bit(gpio, asustor_hw_blinking);
+	return ret;
+}
+
 static const struct gpio_led_platform_data asustor_leds_pdata = {
-	.leds     = asustor_leds,
-	.num_leds = ARRAY_SIZE(asustor_leds),
+	.leds           = asustor_leds,
+	.num_leds       = ARRAY_SIZE(asustor_leds),
+	.gpio_blink_set = asustor_gpio_blink_set,
 };
 
 static struct gpiod_lookup_table asustor_fs6700_gpio_leds_lookup = {
@@ -231,35 +321,34 @@ static struct gpiod_lookup_table asustor_600_gpio_leds_lookup = {
 };
 // clang-format on
 
-// ASUSTOR Buttons.
-// Unfortunately, gpio-keys-polled does not use gpio lookup tables.
+// ASUSTOR Buttons, polled by asustor_keys_poll() through the lookup tables
+// below.
 static struct gpio_keys_button asustor_gpio_keys_table[] = {
 	{
 		.desc       = "USB Copy Button",
 		.code       = KEY_COPY,
 		.type       = EV_KEY,
 		.active_low = 1,
-		.gpio       = -1, // Invalid, set in init.
 	},
 	{
 		.desc       = "Power Button",
 		.code       = KEY_POWER,
 		.type       = EV_KEY,
 		.active_low = 1,
-		.gpio       = -1, // Invalid, set in init.
 	},
 };
 
+#define ASUSTOR_NUM_KEYS ARRAY_SIZE(asustor_gpio_keys_table)
+
 static struct gpio_keys_platform_data asustor_keys_pdata = {
 	.buttons       = asustor_gpio_keys_table,
 	.nbuttons      = ARRAY_SIZE(asustor_gpio_keys_table),
-	.poll_interval = 50,
 	.name          = "asustor-keys",
 };
 
 // clang-format off
 static struct gpiod_lookup_table asustor_fs6700_gpio_keys_lookup = {
-	.dev_id = "gpio-keys-polled",
+	.dev_id = "asustor-keys",
 	.table = {
 		// 0 (There is no USB Copy Button).
 		// 1 (Power Button is already handled properly via ACPI).
@@ -268,7 +357,7 @@ static struct gpiod_lookup_table asustor_fs6700_gpio_keys_lookup = {
 };
 
 static struct gpiod_lookup_table asustor_6100_gpio_keys_lookup = { // same for 6700
-	.dev_id = "gpio-keys-polled",
+	.dev_id = "asustor-keys",
 	.table = {
 		GPIO_LOOKUP_IDX(GPIO_IT87, 20, NULL, 0, GPIO_ACTIVE_LOW),
 		// 1 (Power Button is already handled properly via ACPI).
@@ -277,7 +366,7 @@ static struct gpiod_lookup_table asustor_6100_gpio_keys_lookup = { // same for 6
 };
 
 static struct gpiod_lookup_table asustor_600_gpio_keys_lookup = {
-	.dev_id = "gpio-keys-polled",
+	.dev_id = "asustor-keys",
 	.table = {
 		GPIO_LOOKUP_IDX(GPIO_IT87, 20, NULL, 0, GPIO_ACTIVE_LOW),
 		GPIO_LOOKUP_IDX(GPIO_IT87, 27, NULL, 1, GPIO_ACTIVE_LOW),
@@ -286,6 +375,8 @@ static struct gpiod_lookup_table asustor_600_gpio_keys_lookup = {
 };
 // clang-format on
 
+#define MAX_PCI_MATCHES 4
+
 struct pci_device_match {
 	// match PCI devices with the given vendorID and productID (to help identify ASUSTOR systems)
 	// you can get them from `lspci -nn`, for example in
@@ -306,7 +397,7 @@ enum {
 struct asustor_driver_data {
 	const char *name; // used for force_device and for some log messages
 
-	struct pci_device_match pci_matches[4];
+	struct pci_device_match pci_matches[MAX_PCI_MATCHES];
 
 	struct gpiod_lookup_table *leds;
 	struct gpiod_lookup_table *keys;
@@ -561,44 +652,909 @@ static int get_gpio_base_for_chipname(const char *name)
 }
 #endif
 
-// How many PCI(e) devices with given vendor/device IDs exist in this system?
-static int count_pci_device_instances(unsigned int vendor, unsigned int device)
+// exported by asustor_gpio_it87.ko, looked up with symbol_get() so systems
+// without an IT87 GPIO chip don't need that module
+extern int asustor_gpio_it87_configure(const unsigned long *mask,
+                                       const unsigned long *output,
+                                       const unsigned long *values);
+
+static bool __init asustor_is_activity_led(unsigned int idx);
+
+// Switch all IT87 LED lines to outputs in a single Super I/O config mode
+// session, instead of leds-gpio entering config mode for every LED. Each line
+// starts out at the level leds-gpio or the activity engine will set, so the
+// LEDs don't flash while the drivers bind.
+static void __init asustor_configure_it87_leds(void)
+{
+	int (*configure)(const unsigned long *, const unsigned long *,
+	                 const unsigned long *);
+	const struct gpiod_lookup *leds_table;
+	DECLARE_BITMAP(lines, 64);
+	DECLARE_BITMAP(values, 64);
+	bool on;
+	int ret;
+
+	bitmap_zero(lines, 64);
+	bitmap_zero(values, 64);
+	for (leds_table = driver_data->leds->table; leds_table->key != NULL;
+	     leds_table++) {
+		if (strcmp(leds_table->key, GPIO_IT87) != 0 ||
+		    leds_table->chip_hwnum >= 64 ||
+		    leds_table->idx >= ARRAY_SIZE(asustor_leds))
+			continue;
+
+		// the activity LEDs are requested off; values[] holds raw levels
+		on = asustor_leds[leds_table->idx].default_state ==
+		             LEDS_GPIO_DEFSTATE_ON &&
+		     !asustor_is_activity_led(leds_table->idx);
+		set_bit(leds_table->chip_hwnum, lines);
+		assign_bit(leds_table->chip_hwnum, values,
+		           on != !!(leds_table->flags & GPIO_ACTIVE_LOW));
+	}
+	if (bitmap_empty(lines, 64))
+		return;
+
+	configure = symbol_get(asustor_gpio_it87_configure);
+	if (!configure)
+		return;
+
+	// on failure leds-gpio still sets up each line on its own
+	ret = configure(lines, lines, values);
+	if (ret)
+		pr_warn("failed configuring IT87 LED lines: %d\n", ret);
+
+	symbol_put(asustor_gpio_it87_configure);
+}
+
+// Activity LED engine.
+//
+// Driving the disk LEDs with the disk-activity trigger costs a GPIO write per
+// LED for every I/O burst, blinks all bays together and never fires for NVMe.
+// Instead, the activity LEDs are owned by the "asustor-activity" device and
+// asustor_activity_work() samples the I/O counters of the disk in each bay
+// every activity_led_interval ms. All LEDs on the asustor-disk trigger are
+// then updated with a single gpiod_set_array_value_cansleep() call, i.e. one
+// port write per GPIO port. The work is deferrable, so it doesn't wake up an
+// idle CPU, and only runs while an LED is on the asustor-disk trigger.
+//
+// Bays are found from the PCI topology, see asustor_activity_scan(). LEDs of
+// bays without a known disk stay off.
+
+static uint activity_led_interval = 100;
+module_param(activity_led_interval, uint, S_IRUSR | S_IRGRP | S_IROTH);
+MODULE_PARM_DESC(activity_led_interval,
+                 "Time in ms between disk activity LED updates "
+                 "(default: 100)");
+
+#define ASUSTOR_NUM_LEDS ARRAY_SIZE(asustor_leds)
+// look for added or removed disks every this many samples
+#define ASUSTOR_RESCAN_SAMPLES 50
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 11, 0)
+#define asustor_disk_part0(disk) ((disk)->part0)
+#else
+#define asustor_disk_part0(disk) (&(disk)->part0)
+#endif
+
+struct asustor_activity_led {
+	struct led_classdev cdev;
+	int idx;             // index into asustor_activity_gpios
+	bool nvme;           // bay type and number, from the LED name
+	unsigned int bay;
+	struct device *disk; // disk in that bay (referenced), or NULL
+	unsigned long ios;   // I/O count at the last sample
+};
+
+// lookup table handed to leds-gpio, without the activity LEDs
+static struct gpiod_lookup_table *asustor_leds_lookup;
+// lookup table for the activity LEDs, indexed like asustor_activity_gpios
+static struct gpiod_lookup_table *asustor_activity_lookup;
+static const char *asustor_activity_names[ASUSTOR_NUM_LEDS];
+
+static struct platform_device *asustor_activity_pdev;
+static struct gpio_descs *asustor_activity_gpios;
+static struct asustor_activity_led *asustor_activity_leds;
+static unsigned int asustor_activity_samples;
+
+// protects the bitmaps below, asustor_activity_ready and the GPIO writes
+static DEFINE_MUTEX(asustor_activity_lock);
+// all activity LEDs are registered, the work may run
+static bool asustor_activity_ready;
+// current value of every activity LED
+static DECLARE_BITMAP(asustor_activity_state, ASUSTOR_NUM_LEDS);
+// activity LEDs on the asustor-disk trigger
+static DECLARE_BITMAP(asustor_activity_triggered, ASUSTOR_NUM_LEDS);
+
+static void asustor_activity_work(struct work_struct *work);
+static DECLARE_DEFERRABLE_WORK(asustor_activity_dwork, asustor_activity_work);
+
+static unsigned long asustor_disk_ios(struct device *dev)
+{
+	struct gendisk *disk = dev_to_disk(dev);
+
+	return part_stat_read(asustor_disk_part0(disk), ios[STAT_READ]) +
+	       part_stat_read(asustor_disk_part0(disk), ios[STAT_WRITE]);
+}
+
+// device_for_each_child() callback, finds the first disk below dev
+static int asustor_find_disk(struct device *dev, void *data)
+{
+	struct device **disk = data;
+
+	if (dev->class && dev->type && strcmp(dev->class->name, "block") == 0 &&
+	    strcmp(dev->type->name, "disk") == 0) {
+		*disk = get_device(dev);
+		return 1;
+	}
+	return device_for_each_child(dev, data, asustor_find_disk);
+}
+
+static struct device *asustor_disk_below(struct device *dev)
+{
+	struct device *disk = NULL;
+
+	device_for_each_child(dev, &disk, asustor_find_disk);
+	return disk;
+}
+
+// With native NVMe multipath, the disk below the controller is the hidden
+// per-path disk nvme<subsys>c<ctrl>n<ns>. The I/O goes through the namespace
+// head disk nvme<subsys>n<ns> instead, and may not be counted on the path.
+static struct device *asustor_nvme_head_disk(struct device *disk)
+{
+	unsigned int subsys, ctrl, ns;
+	struct device *head;
+	char name[32];
+	int len = 0;
+
+	if (sscanf(dev_name(disk), "nvme%uc%un%u%n", &subsys, &ctrl, &ns,
+	           &len) != 3 ||
+	    dev_name(disk)[len] != '\0')
+		return disk;
+
+	snprintf(name, sizeof(name), "nvme%un%u", subsys, ns);
+	head = class_find_device_by_name(disk->class, name);
+	if (!head)
+		return disk;
+	put_device(disk);
+	return head;
+}
+
+// store the disk for a bay in disks[] (indexed like asustor_activity_leds)
+static void asustor_activity_assign(struct device **disks, bool nvme,
+                                    unsigned int bay, struct device *disk)
+{
+	int i;
+
+	for (i = 0; i < asustor_activity_gpios->ndescs; i++) {
+		if (asustor_activity_leds[i].nvme == nvme &&
+		    asustor_activity_leds[i].bay == bay && !disks[i]) {
+			disks[i] = disk;
+			return;
+		}
+	}
+	put_device(disk);
+}
+
+struct asustor_sata_scan {
+	struct device **disks;
+	unsigned int base;   // bay number of port 0 minus 1
+	unsigned int nports; // ports of the current controller
+};
+
+// device_for_each_child() callback, finds the SCSI host of a libata port;
+// libata's hosts are told from other drivers' by their queuecommand
+static int asustor_find_ata_shost(struct device *dev, void *data)
+{
+	struct Scsi_Host **shost = data;
+
+	if (!IS_REACHABLE(CONFIG_ATA) || !scsi_is_host_device(dev) ||
+	    dev_to_shost(dev)->hostt->queuecommand != ata_scsi_queuecmd)
+		return 0;
+	*shost = dev_to_shost(dev);
+	return 1;
+}
+
+// device_for_each_child() callback for the ports of a SATA controller
+static int asustor_scan_ata_port(struct device *dev, void *data)
+{
+	struct asustor_sata_scan *scan = data;
+	struct Scsi_Host *shost = NULL;
+	struct ata_port *ap;
+	struct device *disk;
+
+	// libata adds a SCSI host below every port, even an empty one, and
+	// the controller may not be driven by libata at all
+	device_for_each_child(dev, &shost, asustor_find_ata_shost);
+	if (!shost)
+		return 0;
+	ap = ata_shost_to_port(shost);
+	if (&ap->tdev != dev)
+		return 0;
+	scan->nports = max_t(unsigned int, scan->nports, ap->host->n_ports);
+
+	disk = asustor_disk_below(dev);
+	if (disk)
+		asustor_activity_assign(scan->disks, false,
+		                        scan->base + ap->port_no + 1, disk);
+	return 0;
+}
+
+// Bay N of the sataN LEDs is port N-1 counted across the SATA controllers in
+// PCI order, bay N of the nvmeN LEDs is the Nth NVMe controller.
+static void asustor_activity_scan(void)
 {
-	int ret = 0;
-	struct pci_dev *pd, *last_pd = NULL;
+	struct device *disks[ASUSTOR_NUM_LEDS] = { NULL };
+	struct asustor_sata_scan scan = { .disks = disks };
+	struct asustor_activity_led *led;
+	struct pci_dev *pdev = NULL;
+	unsigned int nvme    = 0;
+	struct device *disk;
+	int i;
+
+	for_each_pci_dev(pdev) {
+		switch (pdev->class >> 8) {
+		case PCI_CLASS_STORAGE_SATA:
+			scan.nports = 0;
+			device_for_each_child(&pdev->dev, &scan,
+			                      asustor_scan_ata_port);
+			scan.base += scan.nports;
+			break;
+		case PCI_CLASS_STORAGE_EXPRESS:
+			disk = asustor_disk_below(&pdev->dev);
+			if (disk)
+				asustor_activity_assign(
+					disks, true, nvme + 1,
+					asustor_nvme_head_disk(disk));
+			nvme++;
+			break;
+		}
+	}
+
+	for (i = 0; i < asustor_activity_gpios->ndescs; i++) {
+		led = &asustor_activity_leds[i];
+		if (disks[i] == led->disk) {
+			put_device(disks[i]);
+			continue;
+		}
+		if (disks[i]) {
+			pr_debug("%s shows %s\n", led->cdev.name,
+			         dev_name(disks[i]));
+			led->ios = asustor_disk_ios(disks[i]);
+		}
+		put_device(led->disk);
+		led->disk = disks[i];
+	}
+}
+
+static void asustor_activity_write(void)
+{
+	gpiod_set_array_value_cansleep(asustor_activity_gpios->ndescs,
+	                               asustor_activity_gpios->desc,
+	                               asustor_activity_gpios->info,
+	                               asustor_activity_state);
+}
+
+// Triggered LEDs are on while their disk is idle and toggle every sample with
+// I/O, like disk-activity did, but for all of them in one write. Triggered
+// LEDs of empty bays are off.
+static void asustor_activity_work(struct work_struct *work)
+{
+	DECLARE_BITMAP(old, ASUSTOR_NUM_LEDS);
+	DECLARE_BITMAP(active, ASUSTOR_NUM_LEDS);
+	DECLARE_BITMAP(idle, ASUSTOR_NUM_LEDS);
+	DECLARE_BITMAP(empty, ASUSTOR_NUM_LEDS);
+	unsigned int n = asustor_activity_gpios->ndescs;
+	struct asustor_activity_led *led;
+	unsigned long ios;
+	int i;
+
+	if (asustor_activity_samples++ % ASUSTOR_RESCAN_SAMPLES == 0)
+		asustor_activity_scan();
+
+	bitmap_zero(active, n);
+	bitmap_zero(empty, n);
+	for (i = 0; i < n; i++) {
+		led = &asustor_activity_leds[i];
+		if (!led->disk) {
+			set_bit(i, empty);
+			continue;
+		}
+		ios = asustor_disk_ios(led->disk);
+		if (ios != led->ios)
+			set_bit(i, active);
+		led->ios = ios;
+	}
+
+	mutex_lock(&asustor_activity_lock);
+	bitmap_copy(old, asustor_activity_state, n);
+	bitmap_and(active, active, asustor_activity_triggered, n);
+	bitmap_and(empty, empty, asustor_activity_triggered, n);
+	bitmap_andnot(idle, asustor_activity_triggered, active, n);
+	bitmap_andnot(idle, idle, empty, n);
+	bitmap_xor(asustor_activity_state, asustor_activity_state, active, n);
+	bitmap_or(asustor_activity_state, asustor_activity_state, idle, n);
+	bitmap_andnot(asustor_activity_state, asustor_activity_state, empty,
+	              n);
+	if (!bitmap_equal(old, asustor_activity_state, n))
+		asustor_activity_write();
+	// restarted by asustor_disk_trigger_activate()
+	if (asustor_activity_ready &&
+	    !bitmap_empty(asustor_activity_triggered, n))
+		schedule_delayed_work(&asustor_activity_dwork,
+		                      msecs_to_jiffies(activity_led_interval));
+	mutex_unlock(&asustor_activity_lock);
+}
+
+// Start the work if it stopped, rescanning the bays first as disks may have
+// come and gone in the meantime. Called with asustor_activity_lock held.
+static void asustor_activity_start(void)
+{
+	if (!asustor_activity_ready ||
+	    delayed_work_pending(&asustor_activity_dwork))
+		return;
+	asustor_activity_samples = 0;
+	schedule_delayed_work(&asustor_activity_dwork, 0);
+}
+
+static int asustor_activity_led_set(struct led_classdev *cdev,
+                                    enum led_brightness value)
+{
+	struct asustor_activity_led *led =
+		container_of(cdev, struct asustor_activity_led, cdev);
+
+	mutex_lock(&asustor_activity_lock);
+	assign_bit(led->idx, asustor_activity_state, value != LED_OFF);
+	gpiod_set_value_cansleep(asustor_activity_gpios->desc[led->idx],
+	                         value != LED_OFF);
+	mutex_unlock(&asustor_activity_lock);
+	return 0;
+}
+
+static int asustor_disk_trigger_activate(struct led_classdev *cdev)
+{
+	struct asustor_activity_led *led;
+
+	// only our own LEDs can be updated in batches
+	if (cdev->brightness_set_blocking != asustor_activity_led_set)
+		return -EINVAL;
+	led = container_of(cdev, struct asustor_activity_led, cdev);
+
+	mutex_lock(&asustor_activity_lock);
+	set_bit(led->idx, asustor_activity_triggered);
+	asustor_activity_start();
+	mutex_unlock(&asustor_activity_lock);
+	return 0;
+}
+
+static void asustor_disk_trigger_deactivate(struct led_classdev *cdev)
+{
+	struct asustor_activity_led *led =
+		container_of(cdev, struct asustor_activity_led, cdev);
+
+	mutex_lock(&asustor_activity_lock);
+	clear_bit(led->idx, asustor_activity_triggered);
+	mutex_unlock(&asustor_activity_lock);
+}
+
+static struct led_trigger asustor_disk_trigger = {
+	.name       = ASUSTOR_DISK_TRIGGER,
+	.activate   = asustor_disk_trigger_activate,
+	.deactivate = asustor_disk_trigger_deactivate,
+};
+
+static bool __init asustor_is_activity_led(unsigned int idx)
+{
+	const char *trigger;
+
+	if (idx >= ASUSTOR_NUM_LEDS)
+		return false;
+	trigger = asustor_leds[idx].default_trigger;
+	return trigger && strcmp(trigger, ASUSTOR_DISK_TRIGGER) == 0;
+}
 
-	while ((pd = pci_get_device(vendor, device, last_pd)) != NULL) {
-		if (last_pd) {
-			pci_dev_put(last_pd);
+// Split driver_data->leds into the tables for leds-gpio and for the activity
+// LEDs. leds-gpio skips the activity LEDs as their lookups are missing.
+static int __init asustor_split_leds_lookup(void)
+{
+	const struct gpiod_lookup *src;
+	struct gpiod_lookup_table *leds, *act;
+	int total = 0, nleds = 0, nact = 0;
+
+	for (src = driver_data->leds->table; src->key != NULL; src++)
+		total++;
+
+	leds = kzalloc(struct_size(leds, table, total + 1), GFP_KERNEL);
+	act  = kzalloc(struct_size(act, table, total + 1), GFP_KERNEL);
+	if (!leds || !act) {
+		kfree(leds);
+		kfree(act);
+		return -ENOMEM;
+	}
+	leds->dev_id = driver_data->leds->dev_id;
+	act->dev_id  = "asustor-activity";
+
+	for (src = driver_data->leds->table; src->key != NULL; src++) {
+		if (asustor_is_activity_led(src->idx)) {
+			act->table[nact]     = *src;
+			act->table[nact].idx = nact;
+			asustor_activity_names[nact++] =
+				asustor_leds[src->idx].name;
+		} else {
+			leds->table[nleds++] = *src;
 		}
-		last_pd = pd;
-		++ret;
 	}
-	if (last_pd) {
-		pci_dev_put(last_pd);
+
+	asustor_leds_lookup = leds;
+	if (nact) {
+		asustor_activity_lookup = act;
+	} else {
+		kfree(act);
+	}
+	return 0;
+}
+
+static void asustor_activity_destroy(void)
+{
+	int i;
+
+	if (!asustor_activity_leds)
+		return;
+
+	mutex_lock(&asustor_activity_lock);
+	asustor_activity_ready = false;
+	mutex_unlock(&asustor_activity_lock);
+	cancel_delayed_work_sync(&asustor_activity_dwork);
+	for (i = 0; i < asustor_activity_gpios->ndescs; i++) {
+		if (asustor_activity_leds[i].cdev.dev)
+			led_classdev_unregister(&asustor_activity_leds[i].cdev);
+		put_device(asustor_activity_leds[i].disk);
+	}
+	led_trigger_unregister(&asustor_disk_trigger);
+	kfree(asustor_activity_leds);
+	asustor_activity_leds = NULL;
+	gpiod_put_array(asustor_activity_gpios);
+	platform_device_unregister(asustor_activity_pdev);
+}
+
+static int __init asustor_activity_create(void)
+{
+	struct asustor_activity_led *led;
+	struct led_classdev *cdev;
+	int i, ret;
+
+	if (!asustor_activity_lookup)
+		return 0;
+
+	asustor_activity_pdev = platform_device_register_simple(
+		"asustor-activity", PLATFORM_DEVID_NONE, NULL, 0);
+	if (IS_ERR(asustor_activity_pdev))
+		return PTR_ERR(asustor_activity_pdev);
+
+	// off until the first sample has found the disks in the bays
+	asustor_activity_gpios = gpiod_get_array(&asustor_activity_pdev->dev,
+	                                         NULL, GPIOD_OUT_LOW);
+	if (IS_ERR(asustor_activity_gpios)) {
+		ret = PTR_ERR(asustor_activity_gpios);
+		goto err_pdev;
+	}
+	bitmap_zero(asustor_activity_state, asustor_activity_gpios->ndescs);
+
+	asustor_activity_leds = kcalloc(asustor_activity_gpios->ndescs,
+	                                sizeof(*asustor_activity_leds),
+	                                GFP_KERNEL);
+	if (!asustor_activity_leds) {
+		ret = -ENOMEM;
+		goto err_gpios;
 	}
+
+	ret = led_trigger_register(&asustor_disk_trigger);
+	if (ret)
+		goto err_leds;
+
+	for (i = 0; i < asustor_activity_gpios->ndescs; i++) {
+		led       = &asustor_activity_leds[i];
+		led->idx  = i;
+		led->nvme = sscanf(asustor_activity_names[i], "nvme%u:",
+		                   &led->bay) == 1;
+		if (!led->nvme && sscanf(asustor_activity_names[i], "sata%u:",
+		                         &led->bay) != 1)
+			led->bay = 0; // not a bay LED, never gets a disk
+
+		cdev                          = &led->cdev;
+		cdev->name                    = asustor_activity_names[i];
+		cdev->max_brightness          = 1;
+		cdev->brightness              = 0;
+		cdev->brightness_set_blocking = asustor_activity_led_set;
+		cdev->default_trigger         = ASUSTOR_DISK_TRIGGER;
+		ret = led_classdev_register(&asustor_activity_pdev->dev, cdev);
+		if (ret)
+			goto err_destroy;
+	}
+
+	mutex_lock(&asustor_activity_lock);
+	asustor_activity_ready = true;
+	if (!bitmap_empty(asustor_activity_triggered,
+	                  asustor_activity_gpios->ndescs))
+		asustor_activity_start();
+	mutex_unlock(&asustor_activity_lock);
+	return 0;
+
+err_destroy:
+	for (i = 0; i < asustor_activity_gpios->ndescs; i++) {
+		if (asustor_activity_leds[i].cdev.dev)
+			led_classdev_unregister(&asustor_activity_leds[i].cdev);
+	}
+	led_trigger_unregister(&asustor_disk_trigger);
+err_leds:
+	kfree(asustor_activity_leds);
+	asustor_activity_leds = NULL;
+err_gpios:
+	gpiod_put_array(asustor_activity_gpios);
+err_pdev:
+	platform_device_unregister(asustor_activity_pdev);
 	return ret;
 }
 
+// Board descriptions from a firmware file.
+//
+// Besides the built-in asustor_systems[], boards can be described in a text
+// file loaded with request_firmware(), by default /lib/firmware/asustor/
+// boards.txt, so new models work without rebuilding the module. For example:
+//
+//   # AS5402T, same as the built-in AS6702
+//   board AS5402
+//   dmi sys_vendor Intel Corporation
+//   dmi product_name Jasper Lake Client Platform
+//   pci 8086:4dd3 1 1
+//   led green:status asustor_gpio_it87 31 active_low
+//   key 0 asustor_gpio_it87 20 active_low
+//
+// "dmi" takes sys_vendor, product_name, board_vendor or board_name followed by
+// the exact value, "pci" vendor:device IDs and the min and max count like
+// pci_matches[], "led" a name from asustor_leds[] and "key" an index into
+// asustor_gpio_keys_table[], each followed by the GPIO chip label, the line
+// and optionally active_low. These boards are tried before the built-in ones.
+
+static char *board_file = "asustor/boards.txt";
+module_param(board_file, charp, S_IRUSR | S_IRGRP | S_IROTH);
+MODULE_PARM_DESC(board_file,
+                 "Firmware file with additional board descriptions, "
+                 "empty to disable (default: asustor/boards.txt)");
+
+#define ASUSTOR_MAX_FW_BOARDS 16
+
+struct asustor_fw_board {
+	struct dmi_system_id dmi;
+	struct asustor_driver_data dd;
+	char name[16];
+	int nleds;
+	int nkeys;
+};
+
+static struct asustor_fw_board *asustor_fw_boards;
+static int asustor_num_fw_boards;
+
+static void asustor_free_lookup_keys(struct gpiod_lookup_table *table)
+{
+	struct gpiod_lookup *l;
+
+	if (!table)
+		return;
+	for (l = table->table; l->key != NULL; l++)
+		kfree(l->key);
+	kfree(table);
+}
+
+static void asustor_free_fw_boards(void)
+{
+	int i;
+
+	for (i = 0; i < asustor_num_fw_boards; i++) {
+		asustor_free_lookup_keys(asustor_fw_boards[i].dd.leds);
+		asustor_free_lookup_keys(asustor_fw_boards[i].dd.keys);
+	}
+	kfree(asustor_fw_boards);
+	asustor_fw_boards     = NULL;
+	asustor_num_fw_boards = 0;
+}
+
+static char *__init asustor_next_token(char **args)
+{
+	char *token;
+
+	do {
+		token = strsep(args, " \t");
+	} while (token && !*token);
+	return token;
+}
+
+static int __init asustor_new_fw_board(char *args)
+{
+	struct asustor_fw_board *b;
+	char *name = asustor_next_token(&args);
+
+	if (!name)
+		return -EINVAL;
+	if (asustor_num_fw_boards == ASUSTOR_MAX_FW_BOARDS)
+		return -ENOSPC;
+
+	b = &asustor_fw_boards[asustor_num_fw_boards++];
+	strscpy(b->name, name, sizeof(b->name));
+	b->dd.name         = b->name;
+	b->dmi.driver_data = &b->dd;
+
+	b->dd.leds = kzalloc(struct_size(b->dd.leds, table,
+	                                 ARRAY_SIZE(asustor_leds) + 1),
+	                     GFP_KERNEL);
+	b->dd.keys = kzalloc(struct_size(b->dd.keys, table, ASUSTOR_NUM_KEYS + 1),
+	                     GFP_KERNEL);
+	if (!b->dd.leds || !b->dd.keys)
+		return -ENOMEM;
+	b->dd.leds->dev_id = "leds-gpio";
+	b->dd.keys->dev_id = "asustor-keys";
+	return 0;
+}
+
+// parses "<chip> <line> [active_low]" into l, idx is set by the caller
+static int __init asustor_parse_lookup(struct gpiod_lookup *l, char *args)
+{
+	char *chip  = asustor_next_token(&args);
+	char *line  = asustor_next_token(&args);
+	char *flags = asustor_next_token(&args);
+	u16 hwnum;
+
+	if (!chip || !line || kstrtou16(line, 0, &hwnum))
+		return -EINVAL;
+	if (flags && strcmp(flags, "active_low") != 0)
+		return -EINVAL;
+
+	l->key = kstrdup(chip, GFP_KERNEL);
+	if (!l->key)
+		return -ENOMEM;
+	l->chip_hwnum = hwnum;
+	l->flags      = flags ? GPIO_ACTIVE_LOW : GPIO_ACTIVE_HIGH;
+	return 0;
+}
+
+static int __init asustor_parse_dmi(struct asustor_fw_board *b, char *args)
+{
+	static const struct {
+		const char *name;
+		int slot;
+	} fields[] = {
+		{ "sys_vendor", DMI_SYS_VENDOR },
+		{ "product_name", DMI_PRODUCT_NAME },
+		{ "board_vendor", DMI_BOARD_VENDOR },
+		{ "board_name", DMI_BOARD_NAME },
+	};
+	char *field = asustor_next_token(&args);
+	struct dmi_strmatch *m = NULL;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(b->dmi.matches) && !m; i++) {
+		if (b->dmi.matches[i].slot == DMI_NONE)
+			m = &b->dmi.matches[i];
+	}
+	if (!field || !args || !m)
+		return -EINVAL;
+
+	for (i = 0; i < ARRAY_SIZE(fields); i++) {
+		if (strcmp(field, fields[i].name) == 0) {
+			m->slot        = fields[i].slot;
+			m->exact_match = 1;
+			strscpy(m->substr, skip_spaces(args),
+			        sizeof(m->substr));
+			return 0;
+		}
+	}
+	return -EINVAL;
+}
+
+static int __init asustor_parse_pci(struct asustor_fw_board *b, char *args)
+{
+	struct pci_device_match *pdm;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(b->dd.pci_matches); i++) {
+		pdm = &b->dd.pci_matches[i];
+		if (pdm->vendorID == 0 && pdm->deviceID == 0)
+			break;
+	}
+	if (i == ARRAY_SIZE(b->dd.pci_matches))
+		return -ENOSPC;
+
+	if (sscanf(args, "%hx:%hx %hd %hd", &pdm->vendorID, &pdm->deviceID,
+	           &pdm->min_count, &pdm->max_count) != 4)
+		return -EINVAL;
+	return 0;
+}
+
+static int __init asustor_parse_board_line(struct asustor_fw_board *b,
+                                           const char *keyword, char *args)
+{
+	struct gpiod_lookup *l;
+	char *name;
+	unsigned int idx;
+
+	if (!args)
+		return -EINVAL;
+	if (strcmp(keyword, "dmi") == 0)
+		return asustor_parse_dmi(b, args);
+	if (strcmp(keyword, "pci") == 0)
+		return asustor_parse_pci(b, args);
+
+	if (strcmp(keyword, "led") == 0) {
+		name = asustor_next_token(&args);
+		for (idx = 0; idx < ARRAY_SIZE(asustor_leds); idx++) {
+			if (name && strcmp(name, asustor_leds[idx].name) == 0)
+				break;
+		}
+		if (idx == ARRAY_SIZE(asustor_leds) ||
+		    b->nleds == ARRAY_SIZE(asustor_leds))
+			return -EINVAL;
+		l      = &b->dd.leds->table[b->nleds];
+		l->idx = idx;
+		b->nleds++;
+		return asustor_parse_lookup(l, args);
+	}
+
+	if (strcmp(keyword, "key") == 0) {
+		name = asustor_next_token(&args);
+		if (!name || kstrtouint(name, 0, &idx) ||
+		    idx >= ASUSTOR_NUM_KEYS || b->nkeys == ASUSTOR_NUM_KEYS)
+			return -EINVAL;
+		l      = &b->dd.keys->table[b->nkeys];
+		l->idx = idx;
+		b->nkeys++;
+		return asustor_parse_lookup(l, args);
+	}
+
+	return -EINVAL;
+}
+
+// Loads board_file into asustor_fw_boards[]. A missing file is fine, a broken
+// one is ignored as a whole, so the built-in tables are used either way.
+static void __init asustor_load_fw_boards(void)
+{
+	const struct firmware *fw;
+	char *buf, *pos, *line, *keyword;
+	int lineno = 0, ret = 0;
+
+	if (!board_file || !*board_file)
+		return;
+	if (request_firmware_direct(&fw, board_file, NULL))
+		return;
+
+	buf = kmemdup_nul(fw->data, fw->size, GFP_KERNEL);
+	release_firmware(fw);
+	asustor_fw_boards = kcalloc(ASUSTOR_MAX_FW_BOARDS,
+	                            sizeof(*asustor_fw_boards), GFP_KERNEL);
+	if (!buf || !asustor_fw_boards) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	pos = buf;
+	while ((line = strsep(&pos, "\n")) != NULL) {
+		lineno++;
+		line = strim(line);
+		if (!*line || *line == '#')
+			continue;
+
+		keyword = asustor_next_token(&line);
+		if (strcmp(keyword, "board") == 0)
+			ret = asustor_new_fw_board(line);
+		else if (asustor_num_fw_boards == 0)
+			ret = -EINVAL;
+		else
+			ret = asustor_parse_board_line(
+				&asustor_fw_boards[asustor_num_fw_boards - 1],
+				keyword, line);
+		if (ret)
+			break;
+	}
+
+out:
+	if (ret) {
+		pr_err("failed parsing %s (line %d): %d, ignoring it\n",
+		       board_file, lineno, ret);
+		asustor_free_fw_boards();
+	} else {
+		pr_info("loaded %d board descriptions from %s\n",
+		        asustor_num_fw_boards, board_file);
+	}
+	kfree(buf);
+}
+
+// How many PCI(e) devices with each vendor/device ID used in any
+// asustor_systems[] entry exist in this system, counted in a single pass over
+// the PCI bus by count_pci_devices()
+struct pci_device_count {
+	uint16_t vendorID;
+	uint16_t deviceID;
+	int count;
+};
+
+static struct pci_device_count
+	pci_device_counts[(ARRAY_SIZE(asustor_systems) +
+	                   ASUSTOR_MAX_FW_BOARDS) * MAX_PCI_MATCHES] __initdata;
+static int num_pci_device_counts __initdata;
+
+static struct pci_device_count *__init find_pci_device_count(uint16_t vendor,
+                                                             uint16_t device)
+{
+	int i;
+
+	for (i = 0; i < num_pci_device_counts; i++) {
+		if (pci_device_counts[i].vendorID == vendor &&
+		    pci_device_counts[i].deviceID == device)
+			return &pci_device_counts[i];
+	}
+	return NULL;
+}
+
+static void __init add_pci_device_counts(const struct asustor_driver_data *dd)
+{
+	struct pci_device_count *cnt;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(dd->pci_matches); i++) {
+		const struct pci_device_match *pdm;
+		pdm = &dd->pci_matches[i];
+		if (pdm->vendorID == 0 && pdm->deviceID == 0)
+			break;
+		if (find_pci_device_count(pdm->vendorID, pdm->deviceID))
+			continue;
+		cnt = &pci_device_counts[num_pci_device_counts];
+		num_pci_device_counts++;
+		cnt->vendorID = pdm->vendorID;
+		cnt->deviceID = pdm->deviceID;
+	}
+}
+
+static void __init count_pci_devices(void)
+{
+	struct pci_device_count *cnt;
+	struct pci_dev *pd = NULL;
+	int i;
+
+	// collect the IDs the rules ask for
+	for (i = 0; i < asustor_num_fw_boards; i++)
+		add_pci_device_counts(&asustor_fw_boards[i].dd);
+	for (i = 0; i < ARRAY_SIZE(asustor_systems); i++) {
+		if (asustor_systems[i].driver_data == NULL)
+			break;
+		add_pci_device_counts(asustor_systems[i].driver_data);
+	}
+
+	for_each_pci_dev(pd) {
+		cnt = find_pci_device_count(pd->vendor, pd->device);
+		if (cnt)
+			cnt->count++;
+	}
+}
+
 // check if sys->pci_matches[] match with the PCI devices in the system
 // NOTE: this only checks if the devices in sys->pci_matches[] exist in the system
 //       with the expected count (or the device does *not* exist if the counts are 0),
 //       PCI devices existing that aren't listed in sys->pci_matches[] is expected
 //       and does not make this function fail.
-static bool pci_devices_match(const struct asustor_driver_data *sys)
+static bool __init pci_devices_match(const struct asustor_driver_data *sys)
 {
 	int i;
 	for (i = 0; i < ARRAY_SIZE(sys->pci_matches); ++i) {
 		int dev_cnt;
 		const struct pci_device_match *pdm;
+		const struct pci_device_count *cnt;
 		pdm = &sys->pci_matches[i];
 		if (pdm->vendorID == 0 && pdm->deviceID == 0) {
 			// no more entries, the previous ones matched
 			// or we would've returned false already
 			return true;
 		}
-		dev_cnt = count_pci_device_instances(pdm->vendorID,
-		                                     pdm->deviceID);
+		cnt     = find_pci_device_count(pdm->vendorID, pdm->deviceID);
+		dev_cnt = cnt ? cnt->count : 0;
 		if (dev_cnt < pdm->min_count || dev_cnt > pdm->max_count) {
 			return false;
 		}
@@ -613,10 +1569,23 @@ extern bool asustor_dmi_matches(const struct dmi_system_id *dmi);
 // find out which ASUSTOR system this is, based on asustor_systems[], including
 // their linked asustor_driver_data's pci_matches
 // returns NULL if this isn't a known system
-static const struct dmi_system_id *find_matching_asustor_system(void)
+static const struct dmi_system_id *__init find_matching_asustor_system(void)
 {
 	int as_idx;
 
+	count_pci_devices();
+
+	// boards from board_file take precedence, but need a DMI match
+	for (as_idx = 0; as_idx < asustor_num_fw_boards; as_idx++) {
+		const struct dmi_system_id *sys;
+		sys = &asustor_fw_boards[as_idx].dmi;
+		if (sys->matches[0].slot == DMI_NONE)
+			continue;
+		if (asustor_dmi_matches(sys) &&
+		    pci_devices_match(sys->driver_data))
+			return sys;
+	}
+
 	for (as_idx = 0; as_idx < ARRAY_SIZE(asustor_systems); as_idx++) {
 		struct asustor_driver_data *dd;
 		const struct dmi_system_id *sys;
@@ -649,16 +1618,151 @@ MODULE_PARM_DESC(
 	"Don't try to detect ASUSTOR device, use the given one instead. "
 	"Valid values: " VALID_OVERRIDE_NAMES);
 
+// The IT87 GPIO lines latch no edges and have no interrupt, so a press
+// shorter than the poll interval can fall between two polls and get lost.
+static uint button_poll_interval = 50;
+module_param(button_poll_interval, uint, S_IRUSR | S_IRGRP | S_IROTH);
+MODULE_PARM_DESC(button_poll_interval,
+                 "Button poll interval in ms, presses must be at least this "
+                 "long (default: 50)");
+
+static struct input_dev *asustor_keys_input;
+static struct gpio_desc *asustor_keys_gpios[ASUSTOR_NUM_KEYS];
+static int asustor_keys_state[ASUSTOR_NUM_KEYS];
+
+static void asustor_keys_poll(struct input_dev *input)
+{
+	const struct gpio_keys_button *button;
+	bool changed = false;
+	int i, state;
+
+	for (i = 0; i < ARRAY_SIZE(asustor_keys_gpios); i++) {
+		if (!asustor_keys_gpios[i])
+			continue;
+		state = gpiod_get_value_cansleep(asustor_keys_gpios[i]);
+		if (state < 0 || state == asustor_keys_state[i])
+			continue;
+
+		button = &asustor_gpio_keys_table[i];
+		input_event(input, button->type, button->code, state);
+		asustor_keys_state[i] = state;
+		changed = true;
+	}
+
+	if (changed)
+		input_sync(input);
+}
+
+static void asustor_keys_put_gpios(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(asustor_keys_gpios); i++) {
+		if (asustor_keys_gpios[i])
+			gpiod_put(asustor_keys_gpios[i]);
+		asustor_keys_gpios[i] = NULL;
+	}
+}
+
+// Used instead of gpio-keys-polled, which can't get its GPIOs through the
+// lookup tables.
+static struct platform_device *__init asustor_keys_poller_create(void)
+{
+	struct platform_device *pdev;
+	struct gpio_desc *desc;
+	int i, nbuttons = 0, ret;
+
+	pdev = platform_device_register_simple(asustor_keys_pdata.name,
+	                                       PLATFORM_DEVID_NONE, NULL, 0);
+	if (IS_ERR(pdev)) {
+		pr_err("failed registering %s: %ld\n", asustor_keys_pdata.name,
+		       PTR_ERR(pdev));
+		return pdev;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(asustor_keys_gpios); i++) {
+		desc = gpiod_get_index_optional(&pdev->dev, NULL, i, GPIOD_IN);
+		if (IS_ERR(desc)) {
+			ret = PTR_ERR(desc);
+			goto err_put;
+		}
+		asustor_keys_gpios[i] = desc;
+		if (desc)
+			nbuttons++;
+	}
+	if (nbuttons == 0) {
+		// nothing to poll, e.g. the power button is handled by ACPI
+		platform_device_unregister(pdev);
+		return NULL;
+	}
+
+	asustor_keys_input = input_allocate_device();
+	if (!asustor_keys_input) {
+		ret = -ENOMEM;
+		goto err_put;
+	}
+
+	asustor_keys_input->name       = asustor_keys_pdata.name;
+	asustor_keys_input->phys       = "asustor-keys/input0";
+	asustor_keys_input->id.bustype = BUS_HOST;
+	asustor_keys_input->dev.parent = &pdev->dev;
+
+	for (i = 0; i < ARRAY_SIZE(asustor_keys_gpios); i++) {
+		if (asustor_keys_gpios[i])
+			input_set_capability(asustor_keys_input,
+			                     asustor_gpio_keys_table[i].type,
+			                     asustor_gpio_keys_table[i].code);
+	}
+
+	ret = input_setup_polling(asustor_keys_input, asustor_keys_poll);
+	if (ret)
+		goto err_free;
+	input_set_poll_interval(asustor_keys_input, button_poll_interval);
+
+	ret = input_register_device(asustor_keys_input);
+	if (ret)
+		goto err_free;
+
+	return pdev;
+
+err_free:
+	input_free_device(asustor_keys_input);
+	asustor_keys_input = NULL;
+err_put:
+	asustor_keys_put_gpios();
+	platform_device_unregister(pdev);
+	pr_err("failed setting up button polling: %d\n", ret);
+	return ERR_PTR(ret);
+}
+
+static void asustor_keys_poller_destroy(void)
+{
+	if (!asustor_keys_input)
+		return;
+
+	input_unregister_device(asustor_keys_input);
+	asustor_keys_input = NULL;
+	asustor_keys_put_gpios();
+}
+
 static int __init asustor_init(void)
 {
 	const struct dmi_system_id *system;
-	const struct gpiod_lookup *keys_table;
 	int ret, i;
 
 	driver_data = NULL;
+	asustor_load_fw_boards();
 	// allow overriding detection with force_device kernel parameter
 	if (force_device && *force_device) {
-		for (i = 0; i < ARRAY_SIZE(asustor_systems); i++) {
+		for (i = 0; i < asustor_num_fw_boards; i++) {
+			struct asustor_fw_board *b = &asustor_fw_boards[i];
+			if (strcmp(force_device, b->name) == 0) {
+				driver_data = &b->dd;
+				break;
+			}
+		}
+		for (i = 0; i < ARRAY_SIZE(asustor_systems) && !driver_data;
+		     i++) {
 			struct asustor_driver_data *dd =
 				asustor_systems[i].driver_data;
 			if (dd && dd->name &&
@@ -672,6 +1776,7 @@ static int __init asustor_init(void)
 			       force_device);
 			pr_info("  valid force_device values are: %s\n",
 			        VALID_OVERRIDE_NAMES);
+			asustor_free_fw_boards();
 			return -EINVAL;
 		}
 		pr_info("force_device parameter is set to \"%s\", treating your machine as "
@@ -681,6 +1786,7 @@ static int __init asustor_init(void)
 		system = find_matching_asustor_system();
 		if (!system) {
 			pr_info("No supported ASUSTOR mainboard found");
+			asustor_free_fw_boards();
 			return -ENODEV;
 		}
 
@@ -690,25 +1796,18 @@ static int __init asustor_init(void)
 		        system->matches[0].substr, system->matches[1].substr);
 	}
 
-	gpiod_add_lookup_table(driver_data->leds);
+	ret = asustor_split_leds_lookup();
+	if (ret) {
+		asustor_free_fw_boards();
+		return ret;
+	}
+	gpiod_add_lookup_table(asustor_leds_lookup);
+	if (asustor_activity_lookup)
+		gpiod_add_lookup_table(asustor_activity_lookup);
 	gpiod_add_lookup_table(driver_data->keys);
 
-	for (i = 0; i < ARRAY_SIZE(asustor_gpio_keys_table); i++) {
-		// This is here simply because gpio-keys-polled does
-		// not support gpio lookups.
-		keys_table = driver_data->keys->table;
-		for (; keys_table->key != NULL; keys_table++) {
-			if (i == keys_table->idx) {
-				// add the GPIO chip's base, so we get the absolute (global) gpio number
-				const char *cn = keys_table->key;
-				int gpio_base  = get_gpio_base_for_chipname(cn);
-				if (gpio_base == -1)
-					continue;
-				asustor_gpio_keys_table[i].gpio =
-					gpio_base + keys_table->chip_hwnum;
-			}
-		}
-	}
+	asustor_it87_gpio_base = get_gpio_base_for_chipname(GPIO_IT87);
+	asustor_configure_it87_leds();
 
 	// TODO(mafredri): Handle number of disk slots -> enabled LEDs.
 	asustor_leds_pdev = asustor_create_pdev(
@@ -718,30 +1817,48 @@ static int __init asustor_init(void)
 		goto err;
 	}
 
-	asustor_keys_pdev =
-		asustor_create_pdev("gpio-keys-polled", &asustor_keys_pdata,
-	                            sizeof(asustor_keys_pdata));
+	// not fatal, the other LEDs and the buttons still work without it
+	ret = asustor_activity_create();
+	if (ret)
+		pr_warn("failed setting up the disk activity LEDs: %d\n", ret);
+
+	asustor_keys_pdev = asustor_keys_poller_create();
 	if (IS_ERR(asustor_keys_pdev)) {
 		ret = PTR_ERR(asustor_keys_pdev);
+		asustor_activity_destroy();
 		platform_device_unregister(asustor_leds_pdev);
+		flush_work(&asustor_blink_stop_work);
 		goto err;
 	}
 
 	return 0;
 
 err:
-	gpiod_remove_lookup_table(driver_data->leds);
+	gpiod_remove_lookup_table(asustor_leds_lookup);
+	if (asustor_activity_lookup)
+		gpiod_remove_lookup_table(asustor_activity_lookup);
 	gpiod_remove_lookup_table(driver_data->keys);
+	kfree(asustor_leds_lookup);
+	kfree(asustor_activity_lookup);
+	asustor_free_fw_boards();
 	return ret;
 }
 
 static void __exit asustor_cleanup(void)
 {
 	platform_device_unregister(asustor_leds_pdev);
+	flush_work(&asustor_blink_stop_work);
+	asustor_activity_destroy();
+	asustor_keys_poller_destroy();
 	platform_device_unregister(asustor_keys_pdev);
 
-	gpiod_remove_lookup_table(driver_data->leds);
+	gpiod_remove_lookup_table(asustor_leds_lookup);
+	if (asustor_activity_lookup)
+		gpiod_remove_lookup_table(asustor_activity_lookup);
 	gpiod_remove_lookup_table(driver_data->keys);
+	kfree(asustor_leds_lookup);
+	kfree(asustor_activity_lookup);
+	asustor_free_fw_boards();
 }
 
 module_init(asustor_init);
@@ -752,5 +1869,4 @@ MODULE_DESCRIPTION("Platform driver for ASUSTOR NAS hardware");
 MODULE_LICENSE("GPL");
 MODULE_ALIAS("platform:asustor");
 MODULE_SOFTDEP("pre: asustor-it87 asustor-gpio-it87 gpio-ich"
-               " platform:leds-gpio"
-               " platform:gpio-keys-polled");
+               " platform:leds-gpio");
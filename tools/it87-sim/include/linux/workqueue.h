@@ -0,0 +1,5 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+#ifndef SIM_LINUX_WORKQUEUE_H
+#define SIM_LINUX_WORKQUEUE_H
+#include "../sim_kernel.h"
+#endif
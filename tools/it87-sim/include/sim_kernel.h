@@ -0,0 +1,828 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Just enough of the kernel API to build asustor_it87.c as a userspace
+ * program. Port and MMIO accesses go to the simulated chip in sim.c,
+ * platform devices, devres, hwmon registration and delayed work are
+ * recorded so that the harness can drive the driver like the kernel would.
+ */
+#ifndef SIM_KERNEL_H
+#define SIM_KERNEL_H
+
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/types.h>
+
+#include "sim.h"
+
+/* Types */
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+typedef u16 __le16;
+typedef u32 __le32;
+typedef u64 __le64;
+typedef u64 phys_addr_t;
+typedef u64 resource_size_t;
+typedef unsigned short umode_t;
+typedef unsigned int gfp_t;
+
+#define GFP_KERNEL	0
+
+#ifndef ENOTSUPP
+#define ENOTSUPP	524
+#endif
+
+/* Compiler and annotations */
+
+#define __init
+#define __exit
+#define __initdata
+#define __initconst
+#define __iomem
+#define __packed	__attribute__((packed))
+#define __always_unused	__attribute__((unused))
+#define __maybe_unused	__attribute__((unused))
+#define __printf(a, b)	__attribute__((format(printf, a, b)))
+#define fallthrough	__attribute__((fallthrough))
+#define likely(x)	__builtin_expect(!!(x), 1)
+#define unlikely(x)	__builtin_expect(!!(x), 0)
+#define READ_ONCE(x)	(*(volatile typeof(x) *)&(x))
+#define WRITE_ONCE(x, v) (*(volatile typeof(x) *)&(x) = (v))
+#define BUILD_BUG_ON(cond) _Static_assert(!(cond), #cond)
+#define WARN_ON(cond)	({ bool __c = !!(cond); \
+			   if (__c) sim_warn(__FILE__, __LINE__, #cond); __c; })
+#define WARN_ON_ONCE(cond) WARN_ON(cond)
+
+#define __is_defined(x)			___is_defined(x)
+#define ___is_defined(val)		____is_defined(__ARG_PLACEHOLDER_##val)
+#define __ARG_PLACEHOLDER_1		0,
+#define ____is_defined(arg1_or_junk)	__take_second_arg(arg1_or_junk 1, 0)
+#define __take_second_arg(__ignored, val, ...) val
+#define IS_ENABLED(option)		__is_defined(option)
+
+#define CONFIG_THERMAL 1
+
+/* Math and bits */
+
+#define ARRAY_SIZE(a)		(sizeof(a) / sizeof((a)[0]))
+#define BIT(n)			(1UL << (n))
+#define BIT_ULL(n)		(1ULL << (n))
+#define GENMASK(h, l)		((~0UL << (l)) & (~0UL >> (63 - (h))))
+#define GENMASK_ULL(h, l)	((~0ULL << (l)) & (~0ULL >> (63 - (h))))
+#define BITS_PER_LONG		64
+#define BITS_TO_LONGS(n)	(((n) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+#define DIV_ROUND_UP(n, d)	(((n) + (d) - 1) / (d))
+#define DIV_ROUND_CLOSEST(x, d) ({ typeof(x) __x = (x); typeof(d) __d = (d); \
+	(((typeof(x))-1) > 0 || ((typeof(d))-1) > 0 || (((__x) > 0) == ((__d) > 0))) ? \
+	(((__x) + ((__d) / 2)) / (__d)) : (((__x) - ((__d) / 2)) / (__d)); })
+
+#define min(a, b)		({ typeof(a) __a = (a); typeof(b) __b = (b); \
+				   __a < __b ? __a : __b; })
+#define max(a, b)		({ typeof(a) __a = (a); typeof(b) __b = (b); \
+				   __a > __b ? __a : __b; })
+#define min_t(t, a, b)		min((t)(a), (t)(b))
+#define max_t(t, a, b)		max((t)(a), (t)(b))
+#define clamp(v, lo, hi)	min(max(v, lo), hi)
+#define clamp_t(t, v, lo, hi)	clamp((t)(v), (t)(lo), (t)(hi))
+#define clamp_val(v, lo, hi)	clamp_t(typeof(v), v, lo, hi)
+#define abs(x)			({ typeof(x) __x = (x); __x < 0 ? -__x : __x; })
+
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+static inline u64 div_u64(u64 a, u32 b) { return a / b; }
+static inline s64 div_s64(s64 a, s32 b) { return a / b; }
+static inline s64 div64_s64(s64 a, s64 b) { return a / b; }
+
+#define cpu_to_le16(x)	((__le16)(x))
+#define cpu_to_le32(x)	((__le32)(x))
+#define cpu_to_le64(x)	((__le64)(x))
+#define le16_to_cpu(x)	((u16)(x))
+#define le32_to_cpu(x)	((u32)(x))
+#define le64_to_cpu(x)	((u64)(x))
+
+/* Bitmaps, not atomic: the harness is single threaded */
+
+#define DECLARE_BITMAP(name, bits)	unsigned long name[BITS_TO_LONGS(bits)]
+
+static inline unsigned long __ffs(unsigned long word)
+{
+	return __builtin_ctzl(word);
+}
+
+static inline bool test_bit(long nr, const unsigned long *addr)
+{
+	return addr[nr / BITS_PER_LONG] & BIT(nr % BITS_PER_LONG);
+}
+
+static inline void __set_bit(long nr, unsigned long *addr)
+{
+	addr[nr / BITS_PER_LONG] |= BIT(nr % BITS_PER_LONG);
+}
+
+static inline void __clear_bit(long nr, unsigned long *addr)
+{
+	addr[nr / BITS_PER_LONG] &= ~BIT(nr % BITS_PER_LONG);
+}
+
+#define set_bit		__set_bit
+#define clear_bit	__clear_bit
+
+static inline bool test_and_clear_bit(long nr, unsigned long *addr)
+{
+	bool old = test_bit(nr, addr);
+
+	__clear_bit(nr, addr);
+	return old;
+}
+
+static inline void assign_bit(long nr, unsigned long *addr, bool value)
+{
+	if (value)
+		__set_bit(nr, addr);
+	else
+		__clear_bit(nr, addr);
+}
+
+static inline unsigned long find_next_bit(const unsigned long *addr,
+					  unsigned long size,
+					  unsigned long offset)
+{
+	for (; offset < size; offset++) {
+		if (test_bit(offset, addr))
+			return offset;
+	}
+	return size;
+}
+
+#define for_each_set_bit(bit, addr, size) \
+	for ((bit) = find_next_bit((addr), (size), 0); (bit) < (size); \
+	     (bit) = find_next_bit((addr), (size), (bit) + 1))
+
+static inline void bitmap_zero(unsigned long *dst, unsigned int nbits)
+{
+	memset(dst, 0, BITS_TO_LONGS(nbits) * sizeof(long));
+}
+
+static inline bool bitmap_empty(const unsigned long *src, unsigned int nbits)
+{
+	return find_next_bit(src, nbits, 0) == nbits;
+}
+
+static inline void bitmap_or(unsigned long *dst, const unsigned long *a,
+			     const unsigned long *b, unsigned int nbits)
+{
+	unsigned int i;
+
+	for (i = 0; i < BITS_TO_LONGS(nbits); i++)
+		dst[i] = a[i] | b[i];
+}
+
+static inline unsigned int bitmap_weight(const unsigned long *src,
+					 unsigned int nbits)
+{
+	unsigned int i, n = 0;
+
+	for (i = 0; i < nbits; i++)
+		n += test_bit(i, src);
+	return n;
+}
+
+/* Errors */
+
+#define MAX_ERRNO	4095
+#define IS_ERR_VALUE(x)	((unsigned long)(void *)(x) >= (unsigned long)-MAX_ERRNO)
+
+static inline void *ERR_PTR(long error) { return (void *)error; }
+static inline long PTR_ERR(const void *ptr) { return (long)ptr; }
+static inline bool IS_ERR(const void *ptr) { return IS_ERR_VALUE(ptr); }
+static inline bool IS_ERR_OR_NULL(const void *ptr)
+{
+	return !ptr || IS_ERR_VALUE(ptr);
+}
+static inline int PTR_ERR_OR_ZERO(const void *ptr)
+{
+	return IS_ERR(ptr) ? PTR_ERR(ptr) : 0;
+}
+
+/* Logging */
+
+extern int sim_verbose;
+
+#ifndef pr_fmt
+#define pr_fmt(fmt) fmt
+#endif
+#define sim_log(level, fmt, ...) \
+	do { if (sim_verbose >= (level)) \
+		fprintf(stderr, fmt, ##__VA_ARGS__); } while (0)
+#define pr_err(fmt, ...)	sim_log(0, pr_fmt(fmt), ##__VA_ARGS__)
+#define pr_warn(fmt, ...)	sim_log(1, pr_fmt(fmt), ##__VA_ARGS__)
+#define pr_notice(fmt, ...)	sim_log(1, pr_fmt(fmt), ##__VA_ARGS__)
+#define pr_info(fmt, ...)	sim_log(1, pr_fmt(fmt), ##__VA_ARGS__)
+#define pr_debug(fmt, ...)	sim_log(2, pr_fmt(fmt), ##__VA_ARGS__)
+#define dev_err(dev, fmt, ...)	sim_log(0, fmt, ##__VA_ARGS__)
+#define dev_warn(dev, fmt, ...)	sim_log(1, fmt, ##__VA_ARGS__)
+#define dev_info(dev, fmt, ...)	sim_log(1, fmt, ##__VA_ARGS__)
+#define dev_dbg(dev, fmt, ...)	sim_log(2, fmt, ##__VA_ARGS__)
+
+void sim_warn(const char *file, int line, const char *cond);
+
+/* Strings */
+
+static inline char *skip_spaces(const char *str)
+{
+	while (isspace((unsigned char)*str))
+		str++;
+	return (char *)str;
+}
+
+int kstrtol(const char *s, unsigned int base, long *res);
+int kstrtoul(const char *s, unsigned int base, unsigned long *res);
+
+static inline int kstrtoint(const char *s, unsigned int base, int *res)
+{
+	long val;
+	int err = kstrtol(s, base, &val);
+
+	if (!err)
+		*res = val;
+	return err;
+}
+
+static inline int kstrtou8(const char *s, unsigned int base, u8 *res)
+{
+	unsigned long val;
+	int err = kstrtoul(s, base, &val);
+
+	if (err)
+		return err;
+	if (val > 0xff)
+		return -ERANGE;
+	*res = val;
+	return 0;
+}
+
+#define sysfs_emit sprintf
+
+/* Memory */
+
+static inline void *kzalloc(size_t size, gfp_t gfp) { return calloc(1, size); }
+static inline void *kcalloc(size_t n, size_t size, gfp_t gfp)
+{
+	return calloc(n, size);
+}
+static inline void kfree(const void *p) { free((void *)p); }
+
+void sort(void *base, size_t num, size_t size,
+	  int (*cmp)(const void *, const void *), void *swap);
+
+/* Locking: single threaded, but lock misuse is reported */
+
+struct mutex {
+	int held;
+};
+
+#define DEFINE_MUTEX(name) struct mutex name = { 0 }
+
+void mutex_init(struct mutex *lock);
+void mutex_lock(struct mutex *lock);
+void mutex_unlock(struct mutex *lock);
+
+typedef struct {
+	unsigned int sequence;
+} seqcount_t;
+
+static inline void seqcount_init(seqcount_t *s) { s->sequence = 0; }
+static inline unsigned int read_seqcount_begin(const seqcount_t *s)
+{
+	return s->sequence & ~1U;
+}
+static inline int read_seqcount_retry(const seqcount_t *s, unsigned int start)
+{
+	return s->sequence != start;
+}
+static inline void write_seqcount_begin(seqcount_t *s) { s->sequence++; }
+static inline void write_seqcount_end(seqcount_t *s) { s->sequence++; }
+
+#define preempt_disable()	do { } while (0)
+#define preempt_enable()	do { } while (0)
+
+/* Time: jiffies only advance when the harness says so */
+
+#define HZ 1000
+
+#define jiffies			sim_jiffies()
+
+#define time_after(a, b)	((long)((b) - (a)) < 0)
+#define time_before(a, b)	time_after(b, a)
+
+static inline unsigned long msecs_to_jiffies(unsigned int m) { return m; }
+static inline unsigned int jiffies_to_msecs(unsigned long j) { return j; }
+
+static inline u64 ktime_get_ns(void) { return sim_now_ns; }
+
+/* Port and memory I/O, see sim.c */
+
+#define inb(port)		sim_inb(port)
+#define inb_p(port)		sim_inb(port)
+#define outb(val, port)		sim_outb(val, port)
+#define outb_p(val, port)	sim_outb(val, port)
+#define readb(addr)		sim_readb((const volatile void *)(addr))
+#define writeb(val, addr)	sim_writeb(val, (volatile void *)(addr))
+
+struct resource {
+	resource_size_t start;
+	resource_size_t end;
+	const char *name;
+	unsigned long flags;
+};
+
+#define IORESOURCE_IO	0x00000100
+#define IORESOURCE_MEM	0x00000200
+
+static inline resource_size_t resource_size(const struct resource *res)
+{
+	return res->end - res->start + 1;
+}
+
+struct resource *request_muxed_region(resource_size_t start,
+				      resource_size_t n, const char *name);
+struct resource *request_region(resource_size_t start, resource_size_t n,
+				const char *name);
+void release_region(resource_size_t start, resource_size_t n);
+
+/* Devices */
+
+struct kobject {
+	const char *name;
+};
+
+struct device;
+
+struct devres {
+	void (*action)(void *);
+	void *data;
+	struct devres *next;
+};
+
+struct device {
+	struct kobject kobj;
+	struct device *parent;
+	void *driver_data;
+	void *platform_data;
+	struct devres *devres;
+	const char *init_name;
+};
+
+static inline struct device *kobj_to_dev(struct kobject *kobj)
+{
+	return container_of(kobj, struct device, kobj);
+}
+
+static inline void *dev_get_drvdata(const struct device *dev)
+{
+	return dev->driver_data;
+}
+
+static inline void dev_set_drvdata(struct device *dev, void *data)
+{
+	dev->driver_data = data;
+}
+
+static inline void *dev_get_platdata(const struct device *dev)
+{
+	return dev->platform_data;
+}
+
+static inline const char *dev_name(const struct device *dev)
+{
+	return dev->kobj.name;
+}
+
+int devm_add_action_or_reset(struct device *dev, void (*action)(void *),
+			     void *data);
+void devres_release_all(struct device *dev);
+void *devm_kzalloc(struct device *dev, size_t size, gfp_t gfp);
+void *devm_kcalloc(struct device *dev, size_t n, size_t size, gfp_t gfp);
+__printf(3, 4) char *devm_kasprintf(struct device *dev, gfp_t gfp,
+				    const char *fmt, ...);
+struct resource *devm_request_region(struct device *dev,
+				     resource_size_t start,
+				     resource_size_t n, const char *name);
+void __iomem *devm_ioremap_resource(struct device *dev,
+				    const struct resource *res);
+void devm_iounmap(struct device *dev, void __iomem *addr);
+void devm_release_mem_region(struct device *dev, resource_size_t start,
+			     resource_size_t n);
+
+/* Platform devices */
+
+struct platform_device {
+	const char *name;
+	int id;
+	struct device dev;
+	struct resource *resource;
+	unsigned int num_resources;
+};
+
+struct device_driver {
+	const char *name;
+};
+
+struct platform_driver {
+	int (*probe)(struct platform_device *);
+	void (*remove)(struct platform_device *);
+	struct device_driver driver;
+};
+
+#define to_platform_device(d) container_of(d, struct platform_device, dev)
+
+static inline void *platform_get_drvdata(const struct platform_device *pdev)
+{
+	return dev_get_drvdata(&pdev->dev);
+}
+
+static inline void platform_set_drvdata(struct platform_device *pdev,
+					void *data)
+{
+	dev_set_drvdata(&pdev->dev, data);
+}
+
+struct resource *platform_get_resource(struct platform_device *pdev,
+				       unsigned int type, unsigned int num);
+struct platform_device *platform_device_alloc(const char *name, int id);
+int platform_device_add_resources(struct platform_device *pdev,
+				  const struct resource *res,
+				  unsigned int num);
+int platform_device_add_data(struct platform_device *pdev, const void *data,
+			     size_t size);
+int platform_device_add(struct platform_device *pdev);
+void platform_device_put(struct platform_device *pdev);
+void platform_device_unregister(struct platform_device *pdev);
+int platform_driver_register(struct platform_driver *drv);
+void platform_driver_unregister(struct platform_driver *drv);
+
+/* sysfs */
+
+#define S_IRUGO		0444
+#define S_IWUSR		0200
+#define S_IRUSR		0400
+
+struct attribute {
+	const char *name;
+	umode_t mode;
+};
+
+struct device_attribute {
+	struct attribute attr;
+	ssize_t (*show)(struct device *dev, struct device_attribute *attr,
+			char *buf);
+	ssize_t (*store)(struct device *dev, struct device_attribute *attr,
+			 const char *buf, size_t count);
+};
+
+#define __ATTR(_name, _mode, _show, _store) { \
+	.attr = { .name = #_name, .mode = _mode }, \
+	.show = _show, .store = _store }
+
+#define DEVICE_ATTR(_name, _mode, _show, _store) \
+	struct device_attribute dev_attr_##_name = \
+		__ATTR(_name, _mode, _show, _store)
+#define DEVICE_ATTR_RW(_name) \
+	DEVICE_ATTR(_name, 0644, _name##_show, _name##_store)
+#define DEVICE_ATTR_RO(_name) \
+	DEVICE_ATTR(_name, 0444, _name##_show, NULL)
+
+struct file;
+struct bin_attribute {
+	struct attribute attr;
+	size_t size;
+	ssize_t (*read)(struct file *, struct kobject *,
+			struct bin_attribute *, char *, loff_t, size_t);
+};
+
+#define BIN_ATTR_RO(_name, _size) \
+	struct bin_attribute bin_attr_##_name = { \
+		.attr = { .name = #_name, .mode = 0444 }, \
+		.size = _size, .read = _name##_read }
+
+struct attribute_group {
+	const char *name;
+	umode_t (*is_visible)(struct kobject *, struct attribute *, int);
+	struct attribute **attrs;
+	struct bin_attribute **bin_attrs;
+};
+
+ssize_t memory_read_from_buffer(void *to, size_t count, loff_t *ppos,
+				const void *from, size_t available);
+
+/* Modules */
+
+#define THIS_MODULE		NULL
+#define KBUILD_MODNAME		"asustor_it87"
+#define module_param(name, type, perm)
+#define MODULE_PARM_DESC(name, desc)
+#define MODULE_AUTHOR(x)
+#define MODULE_DESCRIPTION(x)
+#define MODULE_LICENSE(x)
+#define MODULE_VERSION(x)
+#define MODULE_SOFTDEP(x)
+#define MODULE_ALIAS(x)
+#define EXPORT_SYMBOL(x)
+#define EXPORT_SYMBOL_GPL(x)
+#define module_init(fn)		int sim_module_init(void) { return fn(); }
+#define module_exit(fn)		void sim_module_exit(void) { fn(); }
+
+/* Version, the driver is built for the pre-6.13 sysfs API */
+
+#define KERNEL_VERSION(a, b, c)	(((a) << 16) + ((b) << 8) + (c))
+#define LINUX_VERSION_CODE	KERNEL_VERSION(6, 12, 0)
+
+/* Delayed work runs when the harness calls sim_run_work() */
+
+struct work_struct;
+typedef void (*work_func_t)(struct work_struct *);
+
+struct work_struct {
+	work_func_t func;
+};
+
+struct delayed_work {
+	struct work_struct work;
+	unsigned long expires;
+	bool pending;
+};
+
+#define INIT_DELAYED_WORK(w, f) \
+	do { (w)->work.func = (f); (w)->pending = false; } while (0)
+
+static inline struct delayed_work *to_delayed_work(struct work_struct *work)
+{
+	return container_of(work, struct delayed_work, work);
+}
+
+bool schedule_delayed_work(struct delayed_work *dwork, unsigned long delay);
+bool cancel_delayed_work_sync(struct delayed_work *dwork);
+
+/* debugfs, discarded */
+
+struct dentry;
+struct inode;
+
+struct seq_file {
+	void *private;
+};
+
+struct file_operations {
+	int (*get)(void *, u64 *);
+	int (*set)(void *, u64);
+	int (*show)(struct seq_file *, void *);
+};
+
+#define DEFINE_DEBUGFS_ATTRIBUTE(name, _get, _set, fmt) \
+	static const struct file_operations name = { .get = _get, .set = _set }
+#define DEFINE_SHOW_ATTRIBUTE(name) \
+	static const struct file_operations name##_fops = { .show = name##_show }
+
+static inline struct dentry *debugfs_create_dir(const char *name,
+						struct dentry *parent)
+{
+	return NULL;
+}
+static inline void debugfs_create_u32(const char *name, umode_t mode,
+				      struct dentry *parent, u32 *value) { }
+static inline void debugfs_create_u64(const char *name, umode_t mode,
+				      struct dentry *parent, u64 *value) { }
+static inline struct dentry *debugfs_create_file(const char *name,
+		umode_t mode, struct dentry *parent, void *data,
+		const struct file_operations *fops)
+{
+	return NULL;
+}
+#define debugfs_create_file_unsafe debugfs_create_file
+static inline void debugfs_remove_recursive(struct dentry *dentry) { }
+
+static inline int seq_puts(struct seq_file *m, const char *s) { return 0; }
+#define seq_printf(m, fmt, ...) ((void)(m))
+
+/* DMI and ACPI: no quirks, no conflicts */
+
+enum dmi_field {
+	DMI_NONE, DMI_SYS_VENDOR, DMI_BOARD_VENDOR, DMI_BOARD_NAME,
+	DMI_PRODUCT_NAME,
+};
+
+struct dmi_strmatch {
+	unsigned char slot;
+	char substr[79];
+};
+
+struct dmi_system_id {
+	int (*callback)(const struct dmi_system_id *);
+	const char *ident;
+	struct dmi_strmatch matches[4];
+	void *driver_data;
+};
+
+#define DMI_MATCH(a, b)	{ .slot = a, .substr = b }
+
+static inline const struct dmi_system_id *
+dmi_first_match(const struct dmi_system_id *list)
+{
+	return NULL;
+}
+
+static inline const char *dmi_get_system_info(int field) { return NULL; }
+
+static inline int acpi_check_resource_conflict(const struct resource *res)
+{
+	return 0;
+}
+
+/* hwmon */
+
+enum hwmon_sensor_types {
+	hwmon_chip, hwmon_temp, hwmon_in, hwmon_curr, hwmon_power,
+	hwmon_energy, hwmon_humidity, hwmon_fan, hwmon_pwm, hwmon_intrusion,
+	hwmon_max,
+};
+
+enum hwmon_chip_attributes {
+	hwmon_chip_temp_reset_history, hwmon_chip_in_reset_history,
+	hwmon_chip_curr_reset_history, hwmon_chip_power_reset_history,
+	hwmon_chip_register_tz, hwmon_chip_update_interval,
+	hwmon_chip_alarms, hwmon_chip_samples, hwmon_chip_curr_samples,
+	hwmon_chip_in_samples, hwmon_chip_power_samples,
+	hwmon_chip_temp_samples, hwmon_chip_beep_enable,
+};
+
+#define HWMON_C_UPDATE_INTERVAL	BIT(hwmon_chip_update_interval)
+#define HWMON_C_ALARMS		BIT(hwmon_chip_alarms)
+
+enum hwmon_temp_attributes {
+	hwmon_temp_enable, hwmon_temp_input, hwmon_temp_type,
+	hwmon_temp_lcrit, hwmon_temp_lcrit_hyst, hwmon_temp_min,
+	hwmon_temp_min_hyst, hwmon_temp_max, hwmon_temp_max_hyst,
+	hwmon_temp_crit, hwmon_temp_crit_hyst, hwmon_temp_emergency,
+	hwmon_temp_emergency_hyst, hwmon_temp_alarm, hwmon_temp_lcrit_alarm,
+	hwmon_temp_min_alarm, hwmon_temp_max_alarm, hwmon_temp_crit_alarm,
+	hwmon_temp_emergency_alarm, hwmon_temp_fault, hwmon_temp_offset,
+	hwmon_temp_label, hwmon_temp_lowest, hwmon_temp_highest,
+	hwmon_temp_reset_history, hwmon_temp_rated_min, hwmon_temp_rated_max,
+	hwmon_temp_beep,
+};
+
+#define HWMON_T_INPUT	BIT(hwmon_temp_input)
+#define HWMON_T_TYPE	BIT(hwmon_temp_type)
+#define HWMON_T_MIN	BIT(hwmon_temp_min)
+#define HWMON_T_MAX	BIT(hwmon_temp_max)
+#define HWMON_T_ALARM	BIT(hwmon_temp_alarm)
+#define HWMON_T_OFFSET	BIT(hwmon_temp_offset)
+#define HWMON_T_BEEP	BIT(hwmon_temp_beep)
+
+enum hwmon_in_attributes {
+	hwmon_in_enable, hwmon_in_input, hwmon_in_min, hwmon_in_max,
+	hwmon_in_lcrit, hwmon_in_crit, hwmon_in_average, hwmon_in_lowest,
+	hwmon_in_highest, hwmon_in_reset_history, hwmon_in_label,
+	hwmon_in_alarm, hwmon_in_min_alarm, hwmon_in_max_alarm,
+	hwmon_in_lcrit_alarm, hwmon_in_crit_alarm, hwmon_in_rated_min,
+	hwmon_in_rated_max, hwmon_in_beep,
+};
+
+#define HWMON_I_INPUT	BIT(hwmon_in_input)
+#define HWMON_I_MIN	BIT(hwmon_in_min)
+#define HWMON_I_MAX	BIT(hwmon_in_max)
+#define HWMON_I_LABEL	BIT(hwmon_in_label)
+#define HWMON_I_ALARM	BIT(hwmon_in_alarm)
+#define HWMON_I_BEEP	BIT(hwmon_in_beep)
+
+enum hwmon_fan_attributes {
+	hwmon_fan_enable, hwmon_fan_input, hwmon_fan_label, hwmon_fan_min,
+	hwmon_fan_max, hwmon_fan_div, hwmon_fan_pulses, hwmon_fan_target,
+	hwmon_fan_alarm, hwmon_fan_min_alarm, hwmon_fan_max_alarm,
+	hwmon_fan_fault, hwmon_fan_beep,
+};
+
+#define HWMON_F_INPUT	BIT(hwmon_fan_input)
+#define HWMON_F_MIN	BIT(hwmon_fan_min)
+#define HWMON_F_DIV	BIT(hwmon_fan_div)
+#define HWMON_F_ALARM	BIT(hwmon_fan_alarm)
+#define HWMON_F_BEEP	BIT(hwmon_fan_beep)
+
+enum hwmon_pwm_attributes {
+	hwmon_pwm_input, hwmon_pwm_enable, hwmon_pwm_mode, hwmon_pwm_freq,
+	hwmon_pwm_auto_channels_temp,
+};
+
+#define HWMON_PWM_INPUT			BIT(hwmon_pwm_input)
+#define HWMON_PWM_ENABLE		BIT(hwmon_pwm_enable)
+#define HWMON_PWM_FREQ			BIT(hwmon_pwm_freq)
+#define HWMON_PWM_AUTO_CHANNELS_TEMP	BIT(hwmon_pwm_auto_channels_temp)
+
+enum hwmon_intrusion_attributes {
+	hwmon_intrusion_alarm, hwmon_intrusion_beep,
+};
+
+#define HWMON_INTRUSION_ALARM	BIT(hwmon_intrusion_alarm)
+
+struct hwmon_channel_info {
+	enum hwmon_sensor_types type;
+	const u32 *config;
+};
+
+#define HWMON_CHANNEL_INFO(stype, ...) \
+	(&(struct hwmon_channel_info) { \
+		.type = hwmon_##stype, \
+		.config = (u32 []) { __VA_ARGS__, 0 } \
+	})
+
+struct hwmon_ops {
+	umode_t (*is_visible)(const void *drvdata,
+			      enum hwmon_sensor_types type, u32 attr,
+			      int channel);
+	int (*read)(struct device *dev, enum hwmon_sensor_types type,
+		    u32 attr, int channel, long *val);
+	int (*read_string)(struct device *dev, enum hwmon_sensor_types type,
+			   u32 attr, int channel, const char **str);
+	int (*write)(struct device *dev, enum hwmon_sensor_types type,
+		     u32 attr, int channel, long val);
+};
+
+struct hwmon_chip_info {
+	const struct hwmon_ops *ops;
+	const struct hwmon_channel_info * const *info;
+};
+
+struct device *devm_hwmon_device_register_with_info(struct device *dev,
+		const char *name, void *drvdata,
+		const struct hwmon_chip_info *info,
+		const struct attribute_group **extra_groups);
+
+struct sensor_device_attribute {
+	struct device_attribute dev_attr;
+	int index;
+};
+
+struct sensor_device_attribute_2 {
+	struct device_attribute dev_attr;
+	u8 index;
+	u8 nr;
+};
+
+#define to_sensor_dev_attr(_dev_attr) \
+	container_of(_dev_attr, struct sensor_device_attribute, dev_attr)
+#define to_sensor_dev_attr_2(_dev_attr) \
+	container_of(_dev_attr, struct sensor_device_attribute_2, dev_attr)
+
+#define SENSOR_DEVICE_ATTR(_name, _mode, _show, _store, _index) \
+	struct sensor_device_attribute sensor_dev_attr_##_name = { \
+		.dev_attr = __ATTR(_name, _mode, _show, _store), \
+		.index = _index }
+
+#define SENSOR_DEVICE_ATTR_2(_name, _mode, _show, _store, _nr, _index) \
+	struct sensor_device_attribute_2 sensor_dev_attr_##_name = { \
+		.dev_attr = __ATTR(_name, _mode, _show, _store), \
+		.index = _index, .nr = _nr }
+
+static inline u8 vid_which_vrm(void) { return 0; }
+static inline int vid_from_reg(int val, u8 vrm) { return val * 25; }
+
+/* Thermal */
+
+struct thermal_cooling_device;
+
+struct thermal_cooling_device_ops {
+	int (*get_max_state)(struct thermal_cooling_device *, unsigned long *);
+	int (*get_cur_state)(struct thermal_cooling_device *, unsigned long *);
+	int (*set_cur_state)(struct thermal_cooling_device *, unsigned long);
+};
+
+struct thermal_cooling_device {
+	const char *type;
+	void *devdata;
+	const struct thermal_cooling_device_ops *ops;
+};
+
+struct device_node;
+
+struct thermal_cooling_device *
+devm_thermal_of_cooling_device_register(struct device *dev,
+					struct device_node *np,
+					const char *type, void *devdata,
+					const struct thermal_cooling_device_ops *ops);
+
+#endif /* SIM_KERNEL_H */
@@ -0,0 +1,225 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Register access benchmark of asustor_it87 against the simulated chip.
+ *
+ * For each workload, reports the port accesses, bank switches and SMBus
+ * isolation toggles it caused, the modelled time per read (using the
+ * per-access costs of the simulated bus) and the CPU time per read spent
+ * in the driver itself.
+ */
+#include <getopt.h>
+#include <time.h>
+
+#include <linux/hwmon.h>
+
+#include "it87_sim.h"
+
+struct sim_read {
+	int type;
+	unsigned int attr;
+	int channel;
+};
+
+static struct sim_read reads[256];
+static int nr_reads;
+
+static void add_visible(int type, unsigned int attr, int channels)
+{
+	long val;
+	int ch;
+
+	for (ch = 0; ch < channels; ch++) {
+		if (nr_reads >= (int)ARRAY_SIZE(reads))
+			return;
+		if (sim_hwmon_read(0, type, attr, ch, &val))
+			continue;
+		reads[nr_reads].type = type;
+		reads[nr_reads].attr = attr;
+		reads[nr_reads].channel = ch;
+		nr_reads++;
+	}
+}
+
+/* What "sensors" reads for each channel */
+static void collect_reads(void)
+{
+	add_visible(hwmon_in, hwmon_in_input, 13);
+	add_visible(hwmon_in, hwmon_in_min, 13);
+	add_visible(hwmon_in, hwmon_in_max, 13);
+	add_visible(hwmon_in, hwmon_in_alarm, 13);
+	add_visible(hwmon_fan, hwmon_fan_input, 6);
+	add_visible(hwmon_fan, hwmon_fan_min, 6);
+	add_visible(hwmon_fan, hwmon_fan_alarm, 6);
+	add_visible(hwmon_temp, hwmon_temp_input, 6);
+	add_visible(hwmon_temp, hwmon_temp_min, 6);
+	add_visible(hwmon_temp, hwmon_temp_max, 6);
+	add_visible(hwmon_temp, hwmon_temp_type, 6);
+	add_visible(hwmon_temp, hwmon_temp_alarm, 6);
+	add_visible(hwmon_pwm, hwmon_pwm_input, 6);
+	add_visible(hwmon_pwm, hwmon_pwm_enable, 6);
+	add_visible(hwmon_pwm, hwmon_pwm_freq, 6);
+	add_visible(hwmon_chip, hwmon_chip_alarms, 1);
+}
+
+static uint64_t cpu_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+struct result {
+	uint64_t reads;
+	uint64_t port_accesses;
+	uint64_t mmio_accesses;
+	uint64_t bank_switches;
+	uint64_t special_cfg_writes;
+	uint64_t virt_ns;
+	uint64_t cpu_ns;
+};
+
+static void report(const char *name, const struct result *r)
+{
+	double n = r->reads ? r->reads : 1;
+
+	printf("%-22s %8llu %10.2f %10.2f %10.3f %10.3f %10.1f %8.1f\n", name,
+	       (unsigned long long)r->reads,
+	       r->port_accesses / n, r->mmio_accesses / n,
+	       r->bank_switches / n, r->special_cfg_writes / n,
+	       r->virt_ns / n, r->cpu_ns / n);
+}
+
+/*
+ * Run @iterations passes over the reads selected by @filter. With @cold,
+ * each pass starts with an empty register cache, as if the reader came
+ * back after more than the cache lifetime.
+ */
+static void run(const char *name, int iterations, bool cold,
+		bool (*filter)(const struct sim_read *))
+{
+	struct result r = { 0 };
+	uint64_t t0, v0;
+	long val;
+	int it, i;
+
+	sim_clear_stats();
+	v0 = sim_now_ns;
+	t0 = cpu_ns();
+	for (it = 0; it < iterations; it++) {
+		if (cold)
+			sim_it87_invalidate(0);
+		for (i = 0; i < nr_reads; i++) {
+			if (filter && !filter(&reads[i]))
+				continue;
+			sim_hwmon_read(0, reads[i].type, reads[i].attr,
+				       reads[i].channel, &val);
+			r.reads++;
+		}
+	}
+	r.cpu_ns = cpu_ns() - t0;
+	r.virt_ns = sim_now_ns - v0;
+	r.port_accesses = sim_stats.port_accesses;
+	r.mmio_accesses = sim_stats.mmio_accesses;
+	r.bank_switches = sim_stats.bank_switches;
+	r.special_cfg_writes = sim_stats.special_cfg_writes;
+	report(name, &r);
+}
+
+static bool only_temp_input(const struct sim_read *r)
+{
+	return r->type == hwmon_temp && r->attr == hwmon_temp_input &&
+	       r->channel == 0;
+}
+
+static bool only_inputs(const struct sim_read *r)
+{
+	return (r->type == hwmon_in && r->attr == hwmon_in_input) ||
+	       (r->type == hwmon_fan && r->attr == hwmon_fan_input) ||
+	       (r->type == hwmon_temp && r->attr == hwmon_temp_input);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-i iterations] [-m] [-p port_ns] [-M mmio_ns] [-s sample_ms] [-v]\n"
+		"  -m  simulate an IT8665E with a working MMIO window\n",
+		prog);
+}
+
+int main(int argc, char **argv)
+{
+	struct sim_config cfg;
+	struct sim_it87_stats st;
+	int iterations = 1000;
+	bool use_mmio = false;
+	unsigned int sample = 0;
+	int opt;
+
+	sim_reset(NULL);
+	cfg = sim_config;
+
+	while ((opt = getopt(argc, argv, "i:mp:M:s:v")) != -1) {
+		switch (opt) {
+		case 'i':
+			iterations = atoi(optarg);
+			break;
+		case 'm':
+			use_mmio = true;
+			break;
+		case 'p':
+			cfg.port_ns = atoi(optarg);
+			break;
+		case 'M':
+			cfg.mmio_ns = atoi(optarg);
+			break;
+		case 's':
+			sample = atoi(optarg);
+			break;
+		case 'v':
+			sim_verbose++;
+			break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (use_mmio) {
+		cfg.devid = 0x8665;
+		cfg.mio = 0x20;		/* Decode enabled, at 0xf0000000 */
+		cfg.special_cfg = 0;
+	}
+
+	sim_reset(&cfg);
+	sim_kernel_reset();
+	sim_it87_set_param("sample_interval", sample);
+	if (sim_module_init() || !sim_hwmon_dev(0)) {
+		fprintf(stderr, "driver failed to load\n");
+		return 1;
+	}
+	sim_it87_stats(0, &st);
+	collect_reads();
+
+	printf("chip %04x, %s, %d readable attributes, driver access_ns %u\n",
+	       cfg.devid, st.mmio ? "MMIO" : "port I/O", nr_reads,
+	       st.access_ns);
+	printf("modelled cost: %u ns per port access, %u ns per MMIO access\n\n",
+	       cfg.port_ns, cfg.mmio_ns);
+	printf("%-22s %8s %10s %10s %10s %10s %10s %8s\n", "workload", "reads",
+	       "port/read", "mmio/read", "banks/read", "smbus/read",
+	       "ns/read", "cpu ns");
+
+	run("temp1_input cold", iterations, true, only_temp_input);
+	run("inputs cold", iterations, true, only_inputs);
+	run("all attributes cold", iterations, true, NULL);
+	run("all attributes cached", iterations, false, NULL);
+
+	sim_it87_stats(0, &st);
+	printf("\nlast refresh: %u port cycles, %u bank switches, %llu ns\n",
+	       st.refresh_port_cycles, st.refresh_bank_switches,
+	       (unsigned long long)st.refresh_ns);
+
+	sim_module_exit();
+	return 0;
+}
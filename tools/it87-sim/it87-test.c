@@ -0,0 +1,407 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Functional tests of asustor_it87 against the simulated chip.
+ */
+#include <linux/hwmon.h>
+
+#include "it87_sim.h"
+
+static int failures, checks;
+
+#define CHECK(cond) do { \
+	checks++; \
+	if (!(cond)) { \
+		failures++; \
+		fprintf(stderr, "FAIL: %s:%d: %s\n", __FILE__, __LINE__, \
+			#cond); \
+	} \
+} while (0)
+
+#define CHECK_EQ(a, b) do { \
+	long long __a = (a), __b = (b); \
+	checks++; \
+	if (__a != __b) { \
+		failures++; \
+		fprintf(stderr, "FAIL: %s:%d: %s == %lld, expected %lld\n", \
+			__FILE__, __LINE__, #a, __a, __b); \
+	} \
+} while (0)
+
+static void load(const struct sim_config *cfg)
+{
+	sim_reset(cfg);
+	sim_kernel_reset();
+	CHECK_EQ(sim_module_init(), 0);
+	CHECK(sim_hwmon_dev(0) != NULL);
+}
+
+/* Invariants that must hold whenever the driver is idle */
+static void check_idle(void)
+{
+	CHECK_EQ(sim_locks_held, 0);
+	CHECK_EQ(sim_stats.lock_errors, 0);
+	CHECK_EQ(sim_stats.smbus_violations, 0);
+	CHECK_EQ(sim_stats.sio_violations, 0);
+	CHECK_EQ(sim_stats.region_conflicts, 0);
+	CHECK_EQ(sim_stats.warnings, 0);
+	CHECK_EQ(sim_sio_ldn[SIM_LDN_PME][SIM_SPECIAL_CFG_REG],
+		 sim_config.special_cfg);
+}
+
+static void unload(void)
+{
+	sim_module_exit();
+	CHECK_EQ(sim_regions_held, 0);
+	CHECK_EQ(sim_cooling_count(), 0);
+	check_idle();
+}
+
+static void test_probe(void)
+{
+	struct sim_it87_stats st;
+
+	load(NULL);
+	check_idle();
+	CHECK_EQ(sim_it87_stats(0, &st), 0);
+	CHECK(!st.mmio);
+	CHECK_EQ(sim_bank, 0);
+	/* Only the EC ports stay claimed, the config ports are muxed */
+	CHECK_EQ(sim_regions_held, 1);
+	unload();
+}
+
+static void test_conversions(void)
+{
+	long val;
+
+	load(NULL);
+	CHECK_EQ(sim_hwmon_read(0, hwmon_temp, hwmon_temp_input, 0, &val), 0);
+	CHECK_EQ(val, 40000);
+	CHECK_EQ(sim_hwmon_read(0, hwmon_temp, hwmon_temp_input, 2, &val), 0);
+	CHECK_EQ(val, 50000);
+	CHECK_EQ(sim_hwmon_read(0, hwmon_fan, hwmon_fan_input, 0, &val), 0);
+	CHECK_EQ(val, 1350000 / (0x0300 * 2));
+	CHECK_EQ(sim_hwmon_read(0, hwmon_in, hwmon_in_input, 0, &val), 0);
+	CHECK(val > 0);
+	check_idle();
+	unload();
+}
+
+static void test_cache(void)
+{
+	uint64_t before;
+	long val;
+
+	load(NULL);
+	CHECK_EQ(sim_hwmon_read(0, hwmon_temp, hwmon_temp_input, 0, &val), 0);
+	before = sim_stats.port_accesses;
+	CHECK_EQ(sim_hwmon_read(0, hwmon_temp, hwmon_temp_input, 0, &val), 0);
+	CHECK_EQ(sim_stats.port_accesses, before);
+
+	/* A new reading shows up once the input cache expired */
+	sim_ec[0][0x29] = 42;
+	sim_advance_ms(2000);
+	CHECK_EQ(sim_hwmon_read(0, hwmon_temp, hwmon_temp_input, 0, &val), 0);
+	CHECK_EQ(val, 42000);
+	check_idle();
+	unload();
+}
+
+/*
+ * The firmware may switch banks while it owns the EC. The driver must
+ * not trust its cached bank, and must hand the EC back in the bank the
+ * firmware left it in.
+ */
+static void test_bank_restore(void)
+{
+	long val;
+
+	load(NULL);
+	sim_firmware_set_bank(2);
+	sim_ec[0][0x29] = 47;
+	sim_advance_ms(2000);
+	CHECK_EQ(sim_hwmon_read(0, hwmon_temp, hwmon_temp_input, 0, &val), 0);
+	CHECK_EQ(val, 47000);
+	CHECK_EQ(sim_bank, 2);
+
+	sim_firmware_set_bank(1);
+	sim_ec[0][0x29] = 48;
+	sim_advance_ms(2000);
+	CHECK_EQ(sim_hwmon_read(0, hwmon_temp, hwmon_temp_input, 0, &val), 0);
+	CHECK_EQ(val, 48000);
+	CHECK_EQ(sim_bank, 1);
+	check_idle();
+	unload();
+}
+
+/* A full refresh toggles the SMBus isolation once, not per register */
+static void test_smbus_toggles(void)
+{
+	long val;
+
+	load(NULL);
+	sim_clear_stats();
+	sim_it87_invalidate(0);
+	CHECK_EQ(sim_hwmon_read(0, hwmon_chip, hwmon_chip_alarms, 0, &val), 0);
+	CHECK_EQ(sim_stats.special_cfg_writes, 2);
+	check_idle();
+	unload();
+}
+
+/* With update_vbat, any refresh of measured values restarts Vbat */
+static void test_update_vbat(void)
+{
+	struct sim_it87_stats st;
+	long val;
+
+	CHECK_EQ(sim_it87_set_param("update_vbat", 1), 0);
+	load(NULL);
+	sim_ec[0][SIM_REG_CONFIG] &= ~0x40;
+	sim_advance_ms(2000);
+	CHECK_EQ(sim_hwmon_read(0, hwmon_temp, hwmon_temp_input, 0, &val), 0);
+	CHECK(sim_ec[0][SIM_REG_CONFIG] & 0x40);
+
+	/* A full refresh reads every bank once */
+	sim_it87_invalidate(0);
+	CHECK_EQ(sim_hwmon_read(0, hwmon_chip, hwmon_chip_alarms, 0, &val), 0);
+	CHECK_EQ(sim_it87_stats(0, &st), 0);
+	CHECK(st.refresh_bank_switches <= 1);
+	check_idle();
+	unload();
+	CHECK_EQ(sim_it87_set_param("update_vbat", 0), 0);
+}
+
+static void test_pwm_manual(void)
+{
+	long val;
+
+	load(NULL);
+	CHECK_EQ(sim_hwmon_write(0, hwmon_pwm, hwmon_pwm_enable, 0, 1), 0);
+	CHECK_EQ(sim_hwmon_write(0, hwmon_pwm, hwmon_pwm_input, 0, 100), 0);
+	CHECK_EQ(sim_ec[0][0x63], 100);
+	CHECK_EQ(sim_ec[0][0x15] & 0x80, 0);
+	CHECK_EQ(sim_hwmon_read(0, hwmon_pwm, hwmon_pwm_input, 0, &val), 0);
+	CHECK_EQ(val, 100);
+	check_idle();
+	unload();
+}
+
+/* GP LED blinking goes through GPIO LDN 7, regs 0xf8-0xfb and 0xc0-0xc4 */
+static void test_gpled_blink(void)
+{
+	unsigned long on = 500, off = 500;
+	unsigned int gpio = 3 * 8 + 2;	/* GP42 */
+	uint8_t *gpio_ldn = sim_sio_ldn[SIM_LDN_GPIO];
+
+	load(NULL);
+	CHECK_EQ(asustor_it87_gpled_blink(gpio, &on, &off), 0);
+	CHECK_EQ(gpio_ldn[0xf8] & 0x3f, (4 << 3) + 2);
+	CHECK_EQ(gpio_ldn[0xc3] & (1 << 2), 0);	/* Alternate function */
+	CHECK(on > 0 && off > 0);
+	check_idle();
+
+	CHECK_EQ(asustor_it87_gpled_blink(gpio, NULL, NULL), 0);
+	CHECK_EQ(gpio_ldn[0xf8] & 0x3f, 0);
+	CHECK(gpio_ldn[0xc3] & (1 << 2));	/* Simple I/O again */
+	check_idle();
+	unload();
+}
+
+/* Mode 3 is 2Hz on the IT8625E but 0.125Hz on chips like the IT8728F */
+static void test_gpled_blink_modes(void)
+{
+	unsigned int gpio = 3 * 8 + 2;	/* GP42 */
+	unsigned long on = 250, off = 250;
+	struct sim_config cfg;
+
+	load(NULL);
+	CHECK_EQ(asustor_it87_gpled_blink(gpio, &on, &off), 0);
+	CHECK_EQ(on, 250);
+	CHECK_EQ(off, 250);
+	CHECK_EQ(asustor_it87_gpled_blink(gpio, NULL, NULL), 0);
+	unload();
+
+	sim_reset(NULL);
+	cfg = sim_config;
+	cfg.devid = 0x8728;
+	cfg.special_cfg = 0;		/* No SMBus isolation to handle */
+	load(&cfg);
+	on = off = 250;
+	CHECK_EQ(asustor_it87_gpled_blink(gpio, &on, &off), -EINVAL);
+	on = off = 4000;
+	CHECK_EQ(asustor_it87_gpled_blink(gpio, &on, &off), 0);
+	CHECK_EQ(on, 4000);
+	CHECK_EQ(off, 4000);
+	CHECK_EQ(sim_sio_ldn[SIM_LDN_GPIO][0xf9] & 0x0e, 3 << 1);
+	CHECK_EQ(asustor_it87_gpled_blink(gpio, NULL, NULL), 0);
+	check_idle();
+	unload();
+}
+
+static void test_snapshot(void)
+{
+	char buf[4096];
+	int len;
+
+	load(NULL);
+	len = sim_bin_attr_read(0, "snapshot", buf, 0, sizeof(buf));
+	CHECK(len > 0);
+	check_idle();
+	unload();
+}
+
+/* Cooling devices only for fans, and never stopping them */
+static void test_cooling(void)
+{
+	unsigned long max, cur;
+	const char *type;
+	int i;
+
+	load(NULL);
+	CHECK_EQ(sim_cooling_count(), 5);
+	for (i = 0; i < sim_cooling_count(); i++) {
+		CHECK_EQ(sim_cooling_get(i, &type, &max, &cur), 0);
+		CHECK(strcmp(type, "it87-pwm3") != 0);
+		CHECK_EQ(max, 7);
+	}
+
+	CHECK_EQ(sim_cooling_get(0, &type, &max, &cur), 0);
+	CHECK(!strcmp(type, "it87-pwm1"));
+	CHECK_EQ(sim_cooling_set(0, 3), -EBUSY);	/* Automatic mode */
+	CHECK_EQ(sim_hwmon_write(0, hwmon_pwm, hwmon_pwm_enable, 0, 1), 0);
+	CHECK_EQ(sim_cooling_set(0, 0), 0);
+	CHECK(sim_ec[0][0x63] >= 64);
+	CHECK_EQ(sim_cooling_set(0, 7), 0);
+	CHECK_EQ(sim_ec[0][0x63], 255);
+	CHECK_EQ(sim_cooling_get(0, &type, &max, &cur), 0);
+	CHECK_EQ(cur, 7);
+	check_idle();
+	unload();
+
+	/* A fan without a tachometer is not a cooling device either */
+	sim_reset(NULL);
+	sim_sio_global[0x25] |= 1 << 6;		/* fan4 pin used for GPIO */
+	sim_kernel_reset();
+	CHECK_EQ(sim_module_init(), 0);
+	CHECK_EQ(sim_cooling_count(), 4);
+	unload();
+}
+
+/*
+ * The integral term must advance by the period the loop actually runs at,
+ * also when fan_loop_interval is below the minimum.
+ */
+static void test_fan_loop(void)
+{
+	char buf[64];
+	long val;
+
+	load(NULL);
+	CHECK_EQ(sim_it87_set_param("fan_loop_kp", 0), 0);
+	CHECK_EQ(sim_it87_set_param("fan_loop_ki", 1), 0);
+	CHECK_EQ(sim_it87_set_param("fan_loop_interval", 10), 0);
+	CHECK(sim_attr_store(0, "pwm1_loop_step", "0") > 0);
+	CHECK_EQ(sim_hwmon_write(0, hwmon_pwm, hwmon_pwm_enable, 0, 1), 0);
+	CHECK_EQ(sim_hwmon_write(0, hwmon_pwm, hwmon_pwm_input, 0, 100), 0);
+
+	/* 10 degrees C above target: 10 steps per second with ki = 1 */
+	sim_ec[0][0x29] = 55;
+	CHECK_EQ(sim_hwmon_write(0, hwmon_pwm, hwmon_pwm_enable, 0, 3), 0);
+	sim_advance_ms(10000);
+	CHECK_EQ(sim_hwmon_read(0, hwmon_pwm, hwmon_pwm_input, 0, &val), 0);
+	CHECK(val >= 190 && val <= 210);
+	CHECK(sim_attr_show(0, "pwm1_loop_target", buf) > 0);
+	check_idle();
+
+	/*
+	 * Without a usable temperature channel, the loop is refused, also
+	 * if the mapping changed behind the cached copy (temp4, absent)
+	 */
+	CHECK_EQ(sim_hwmon_read(0, hwmon_pwm, hwmon_pwm_auto_channels_temp, 1,
+				&val), 0);
+	sim_ec[0][0x16] = (sim_ec[0][0x16] & ~0x38) | (3 << 3);
+	CHECK_EQ(sim_hwmon_write(0, hwmon_pwm, hwmon_pwm_enable, 1, 3),
+		 -EINVAL);
+	check_idle();
+
+	CHECK_EQ(sim_it87_set_param("fan_loop_interval", 2000), 0);
+	CHECK_EQ(sim_it87_set_param("fan_loop_kp", 8), 0);
+	unload();
+	/* Stopping the loop leaves the fan at full speed */
+	CHECK_EQ(sim_ec[0][0x63], 255);
+}
+
+static void mmio_config(struct sim_config *cfg, bool responds)
+{
+	sim_reset(NULL);
+	*cfg = sim_config;
+	cfg->devid = 0x8665;
+	cfg->mio = 0x20;		/* Decode enabled, at 0xf0000000 */
+	cfg->special_cfg = 0;
+	cfg->mmio_responds = responds;
+}
+
+/* Both access paths are timed, whichever is used */
+static void test_mmio(void)
+{
+	struct sim_it87_stats st;
+	struct sim_config cfg;
+	long val;
+
+	mmio_config(&cfg, true);
+	load(&cfg);
+	CHECK_EQ(sim_it87_stats(0, &st), 0);
+	CHECK(st.mmio);
+	CHECK_EQ(st.access_ns, cfg.mmio_ns);
+	CHECK_EQ(st.mmio_access_ns, cfg.mmio_ns);
+	CHECK(st.io_access_ns >= 2 * cfg.port_ns);
+	CHECK_EQ(sim_regions_held, 1);		/* Only the MMIO window */
+	CHECK_EQ(sim_bank, 0);
+	CHECK_EQ(sim_hwmon_read(0, hwmon_temp, hwmon_temp_input, 0, &val), 0);
+	CHECK_EQ(val, 40000);
+	check_idle();
+	unload();
+	CHECK_EQ(sim_mmio_mappings(), 0);
+}
+
+/* A dead MMIO window is unmapped and released right away */
+static void test_mmio_fallback(void)
+{
+	struct sim_it87_stats st;
+	struct sim_config cfg;
+	long val;
+
+	mmio_config(&cfg, false);
+	load(&cfg);
+	CHECK_EQ(sim_it87_stats(0, &st), 0);
+	CHECK(!st.mmio);
+	CHECK_EQ(st.mmio_access_ns, 0);
+	CHECK(st.io_access_ns > 0);
+	CHECK_EQ(sim_regions_held, 1);		/* Only the I/O ports */
+	CHECK_EQ(sim_mmio_mappings(), 0);
+	CHECK_EQ(sim_hwmon_read(0, hwmon_temp, hwmon_temp_input, 0, &val), 0);
+	CHECK_EQ(val, 40000);
+	check_idle();
+	unload();
+}
+
+int main(int argc, char **argv)
+{
+	test_probe();
+	test_conversions();
+	test_cache();
+	test_bank_restore();
+	test_smbus_toggles();
+	test_update_vbat();
+	test_pwm_manual();
+	test_gpled_blink();
+	test_gpled_blink_modes();
+	test_snapshot();
+	test_cooling();
+	test_fan_loop();
+	test_mmio();
+	test_mmio_fallback();
+
+	printf("%d checks, %d failures\n", checks, failures);
+	return failures ? 1 : 0;
+}
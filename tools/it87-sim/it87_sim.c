@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * The driver itself, built against the shim headers, plus a few accessors
+ * for its module parameters and statistics that the harness needs.
+ */
+#include "../../asustor_it87.c"
+
+#include "it87_sim.h"
+
+int sim_it87_set_param(const char *name, unsigned long val)
+{
+	if (!strcmp(name, "mmio"))
+		mmio = val;
+	else if (!strcmp(name, "update_vbat"))
+		update_vbat = val;
+	else if (!strcmp(name, "config_interval"))
+		config_interval = val;
+	else if (!strcmp(name, "sample_interval"))
+		sample_interval = val;
+	else if (!strcmp(name, "fan_loop_interval"))
+		fan_loop_interval = val;
+	else if (!strcmp(name, "fan_loop_kp"))
+		fan_loop_kp = val;
+	else if (!strcmp(name, "fan_loop_ki"))
+		fan_loop_ki = val;
+	else if (!strcmp(name, "cooling_mask"))
+		cooling_mask = val;
+	else
+		return -EINVAL;
+	return 0;
+}
+
+int sim_it87_stats(int index, struct sim_it87_stats *st)
+{
+	struct it87_data *data;
+
+	if (index >= ARRAY_SIZE(it87_pdev) || !it87_pdev[index])
+		return -ENODEV;
+	data = platform_get_drvdata(it87_pdev[index]);
+	if (!data)
+		return -ENODEV;
+
+	st->port_cycles = data->port_cycles;
+	st->bank_switches = data->bank_switches;
+	st->smbus_toggles = data->smbus_toggles;
+	st->refreshes = data->refreshes;
+	st->refresh_port_cycles = data->refresh_port_cycles;
+	st->refresh_bank_switches = data->refresh_bank_switches;
+	st->refresh_ns = data->refresh_ns;
+	st->access_ns = data->access_ns;
+	st->mmio_access_ns = data->mmio_access_ns;
+	st->io_access_ns = data->io_access_ns;
+	st->mmio = !!data->mmio;
+	st->has_fan = data->has_fan;
+	st->has_pwm = data->has_pwm;
+	return 0;
+}
+
+/* Expire all cached registers, as if the cache lifetimes had passed */
+void sim_it87_invalidate(int index)
+{
+	struct it87_data *data;
+
+	if (index >= ARRAY_SIZE(it87_pdev) || !it87_pdev[index])
+		return;
+	data = platform_get_drvdata(it87_pdev[index]);
+	if (data)
+		bitmap_zero(data->snap_valid, IT87_SNAP_GROUPS);
+}
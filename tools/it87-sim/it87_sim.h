@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Driver internals exposed to the harness by it87_sim.c.
+ */
+#ifndef IT87_SIM_H
+#define IT87_SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct sim_it87_stats {
+	uint32_t port_cycles;		/* As counted by the driver */
+	uint32_t bank_switches;
+	uint32_t smbus_toggles;
+	uint32_t refreshes;
+	uint32_t refresh_port_cycles;	/* Of the last refresh */
+	uint32_t refresh_bank_switches;
+	uint64_t refresh_ns;
+	uint32_t access_ns;
+	uint32_t mmio_access_ns;
+	uint32_t io_access_ns;
+	bool mmio;
+	uint8_t has_fan;
+	uint8_t has_pwm;
+};
+
+int sim_it87_set_param(const char *name, unsigned long val);
+int sim_it87_stats(int index, struct sim_it87_stats *st);
+void sim_it87_invalidate(int index);
+
+int asustor_it87_gpled_blink(unsigned int gpio, unsigned long *delay_on,
+			     unsigned long *delay_off);
+
+#endif /* IT87_SIM_H */
@@ -0,0 +1,279 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Simulated ITE Super I/O chip, see sim.h.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "sim.h"
+
+static const struct sim_config sim_default_config = {
+	.devid = 0x8625,
+	.sioaddr = 0x2e,
+	.base = 0x290,
+	.special_cfg = 0x06,	/* SMBus access to the EC on, as on ASUSTOR */
+	.mio = 0,
+	.mmio_responds = true,
+	.port_ns = 1000,	/* Roughly one LPC I/O cycle */
+	.mmio_ns = 150,
+};
+
+struct sim_config sim_config;
+struct sim_stats sim_stats;
+uint8_t sim_ec[SIM_NUM_BANKS][256];
+uint8_t sim_sio_global[0x30];
+uint8_t sim_sio_ldn[SIM_NUM_LDNS][256];
+unsigned int sim_bank;
+uint64_t sim_now_ns;
+uint8_t sim_mmio_window[SIM_MMIO_SIZE];
+
+static unsigned int sio_enter_step;	/* Position in the 87 01 55 55 key */
+static bool sio_config_mode;
+static uint8_t sio_index;
+static uint8_t ec_index;
+
+static void sim_populate_ec(void)
+{
+	static const uint8_t fan_lo[] = { 0x0d, 0x0e, 0x0f, 0x80, 0x82, 0x93 };
+	static const uint8_t pwm[] = { 0x15, 0x16, 0x17, 0x1e, 0x1f, 0x92 };
+	static const uint8_t duty[] = { 0x63, 0x6b, 0x73, 0x7b, 0xa3, 0xab };
+	unsigned int i;
+
+	memset(sim_ec, 0, sizeof(sim_ec));
+
+	sim_ec[0][SIM_REG_CONFIG] = 0x01;	/* Monitoring started */
+	sim_ec[0][SIM_REG_CHIPID] = 0x90;
+	sim_ec[0][0x0c] = 0x37;			/* 16-bit fans, fan4/5 on */
+	sim_ec[0][0x0b] = 0x08;			/* fan6 on */
+	sim_ec[0][0x13] = 0x70;			/* fan1-3 tachometers on */
+	sim_ec[0][0x50] = 0xff;			/* All voltages enabled */
+	sim_ec[0][0x51] = 0x3f;			/* Thermal diodes */
+
+	/* Voltages around mid scale, temperatures 40-65 degrees C */
+	for (i = 0x20; i <= 0x28; i++)
+		sim_ec[0][i] = 0x70 + i;
+	sim_ec[0][0x2f] = 0x80;
+	for (i = 0; i < 3; i++)
+		sim_ec[0][0x29 + i] = 40 + 5 * i;
+	for (i = 0; i < 3; i++)
+		sim_ec[0][0x2c + i] = 55 + 5 * i;
+
+	/* Limits: in min/max pairs, temp high/low */
+	for (i = 0; i < 9; i++) {
+		sim_ec[0][0x30 + i * 2] = 0xff;
+		sim_ec[0][0x31 + i * 2] = 0x00;
+	}
+	for (i = 0; i < 4; i++) {
+		sim_ec[0][0x40 + i * 2] = 90;
+		sim_ec[0][0x41 + i * 2] = 0;
+	}
+
+	/* Tachometers: 16 bit counts of 0x0300, about 880 RPM */
+	for (i = 0; i < 6; i++)
+		sim_ec[0][fan_lo[i]] = 0x00;
+	sim_ec[0][0x18] = sim_ec[0][0x19] = sim_ec[0][0x1a] = 0x03;
+	sim_ec[0][0x81] = sim_ec[0][0x83] = sim_ec[0][0x94] = 0x03;
+
+	/* Fans in automatic mode following temp1, duty cycle 50% */
+	for (i = 0; i < 6; i++) {
+		sim_ec[0][pwm[i]] = 0x80;
+		sim_ec[0][duty[i]] = 0x80;
+	}
+
+	/* Bank 2: temperature sources */
+	sim_ec[2][0x1d] = 0x00;
+	sim_ec[2][0x1e] = 0x00;
+	sim_ec[2][0x1f] = 0x00;
+	sim_ec[2][0x3d] = 0x00;
+}
+
+void sim_reset(const struct sim_config *cfg)
+{
+	sim_config = cfg ? *cfg : sim_default_config;
+	memset(&sim_stats, 0, sizeof(sim_stats));
+	memset(sim_sio_global, 0, sizeof(sim_sio_global));
+	memset(sim_sio_ldn, 0, sizeof(sim_sio_ldn));
+	sim_populate_ec();
+	sim_bank = 0;
+	sim_now_ns = 1000000000ULL;
+	sio_enter_step = 0;
+	sio_config_mode = false;
+	sio_index = 0;
+	ec_index = 0;
+
+	sim_sio_global[0x20] = sim_config.devid >> 8;
+	sim_sio_global[0x21] = sim_config.devid & 0xff;
+	sim_sio_global[0x22] = 0x01;			/* Revision */
+	sim_sio_global[0x27] = 0x02;			/* fan5 pin */
+	sim_sio_global[0x24] = sim_config.mio;
+
+	sim_sio_ldn[SIM_LDN_PME][0x30] = 0x01;		/* Activated */
+	sim_sio_ldn[SIM_LDN_PME][0x60] = sim_config.base >> 8;
+	sim_sio_ldn[SIM_LDN_PME][0x61] = sim_config.base & 0xff;
+	sim_sio_ldn[SIM_LDN_PME][SIM_SPECIAL_CFG_REG] = sim_config.special_cfg;
+
+	/* GPIO: everything in Simple I/O mode, no GP LED mapped */
+	memset(&sim_sio_ldn[SIM_LDN_GPIO][0xc0], 0xff, 5);
+}
+
+void sim_clear_stats(void)
+{
+	memset(&sim_stats, 0, sizeof(sim_stats));
+}
+
+/* The EC is reachable over SMBus unless the driver isolated it */
+bool sim_smbus_enabled(void)
+{
+	return sim_sio_ldn[SIM_LDN_PME][SIM_SPECIAL_CFG_REG] & 0x06;
+}
+
+void sim_firmware_set_bank(unsigned int bank)
+{
+	sim_bank = bank;
+}
+
+static uint8_t *sim_sio_reg(uint8_t index)
+{
+	if (index < 0x30)
+		return &sim_sio_global[index];
+	return &sim_sio_ldn[sim_sio_global[0x07] % SIM_NUM_LDNS][index];
+}
+
+static uint8_t sim_ec_read(uint8_t bank, uint8_t reg)
+{
+	if (sim_smbus_enabled())
+		sim_stats.smbus_violations++;
+	sim_stats.ec_reads++;
+	if (reg == SIM_REG_BANK)
+		return (sim_ec[0][reg] & 0x1f) | (sim_bank << 5);
+	return sim_ec[bank][reg];
+}
+
+static void sim_ec_write(uint8_t bank, uint8_t reg, uint8_t val)
+{
+	if (sim_smbus_enabled())
+		sim_stats.smbus_violations++;
+	sim_stats.ec_writes++;
+	if (reg == SIM_REG_BANK) {
+		if (val >> 5 != sim_bank)
+			sim_stats.bank_switches++;
+		sim_bank = val >> 5;
+		sim_ec[0][reg] = val & 0x1f;
+		return;
+	}
+	sim_ec[bank][reg] = val;
+}
+
+static bool sim_is_sio_port(unsigned int port)
+{
+	return port == sim_config.sioaddr || port == sim_config.sioaddr + 1U;
+}
+
+static bool sim_is_ec_port(unsigned int port)
+{
+	unsigned int ec = sim_config.base + SIM_EC_OFFSET;
+
+	return port == ec || port == ec + 1;
+}
+
+static void sim_port_access(void)
+{
+	sim_stats.port_accesses++;
+	sim_now_ns += sim_config.port_ns;
+}
+
+uint8_t sim_inb(unsigned int port)
+{
+	sim_port_access();
+
+	if (sim_is_sio_port(port)) {
+		sim_stats.sio_accesses++;
+		if (port == sim_config.sioaddr)
+			return sio_index;
+		if (!sio_config_mode) {
+			sim_stats.sio_violations++;
+			return 0xff;
+		}
+		return *sim_sio_reg(sio_index);
+	}
+	if (sim_is_ec_port(port)) {
+		sim_stats.ec_accesses++;
+		if (port == sim_config.base + SIM_EC_OFFSET)
+			return ec_index;
+		return sim_ec_read(sim_bank, ec_index);
+	}
+	return 0xff;
+}
+
+void sim_outb(uint8_t val, unsigned int port)
+{
+	static const uint8_t key[] = { 0x87, 0x01, 0x55, 0x55 };
+
+	sim_port_access();
+
+	if (sim_is_sio_port(port)) {
+		sim_stats.sio_accesses++;
+		if (port == sim_config.sioaddr) {
+			if (!sio_config_mode) {
+				if (val == key[sio_enter_step])
+					sio_enter_step++;
+				else
+					sio_enter_step = val == key[0];
+				if (sio_enter_step == sizeof(key)) {
+					sio_config_mode = true;
+					sio_enter_step = 0;
+				}
+				return;
+			}
+			sio_index = val;
+			return;
+		}
+		if (!sio_config_mode) {
+			sim_stats.sio_violations++;
+			return;
+		}
+		if (sio_index == 0x02) {
+			if (val & 0x02)
+				sio_config_mode = false;
+			return;
+		}
+		if (sio_index == 0x20 || sio_index == 0x21 ||
+		    sio_index == 0x22)
+			return;		/* Read only */
+		if (sio_index == SIM_SPECIAL_CFG_REG &&
+		    sim_sio_global[0x07] == SIM_LDN_PME)
+			sim_stats.special_cfg_writes++;
+		*sim_sio_reg(sio_index) = val;
+		return;
+	}
+	if (sim_is_ec_port(port)) {
+		sim_stats.ec_accesses++;
+		if (port == sim_config.base + SIM_EC_OFFSET)
+			ec_index = val;
+		else
+			sim_ec_write(sim_bank, ec_index, val);
+	}
+}
+
+/* The MMIO window maps all banks linearly, 256 bytes each */
+uint8_t sim_readb(const volatile void *addr)
+{
+	size_t off = (const volatile uint8_t *)addr - sim_mmio_window;
+
+	sim_stats.mmio_accesses++;
+	sim_now_ns += sim_config.mmio_ns;
+	if (off >= SIM_MMIO_SIZE || !sim_config.mmio_responds)
+		return 0xff;
+	return sim_ec_read(off >> 8, off & 0xff);
+}
+
+void sim_writeb(uint8_t val, volatile void *addr)
+{
+	size_t off = (volatile uint8_t *)addr - sim_mmio_window;
+
+	sim_stats.mmio_accesses++;
+	sim_now_ns += sim_config.mmio_ns;
+	if (off >= SIM_MMIO_SIZE || !sim_config.mmio_responds)
+		return;
+	sim_ec_write(off >> 8, off & 0xff, val);
+}
@@ -0,0 +1,106 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Simulated ITE Super I/O chip for the asustor_it87 userspace harness.
+ *
+ * Models the Super I/O configuration ports with the PME (4) and GPIO (7)
+ * logical devices, the environment controller behind the address/data port
+ * pair with banked registers, and the optional MMIO window. Every access is
+ * counted, and a virtual clock advances by a configurable cost per access so
+ * that the driver's own ktime_get_ns() based statistics are deterministic.
+ */
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SIM_NUM_BANKS		8
+#define SIM_NUM_LDNS		16
+#define SIM_EC_OFFSET		5	/* IT87_EC_OFFSET */
+#define SIM_REG_BANK		0x06	/* Bank select in bits 7:5 */
+#define SIM_REG_CONFIG		0x00
+#define SIM_REG_CHIPID		0x58
+#define SIM_LDN_PME		0x04
+#define SIM_LDN_GPIO		0x07
+#define SIM_SPECIAL_CFG_REG	0xf3	/* In LDN 4, SMBus access to the EC */
+#define SIM_MMIO_SIZE		0x400
+
+struct sim_config {
+	uint16_t devid;		/* Super I/O DEVID, 0x8625 by default */
+	uint16_t sioaddr;	/* 0x2e or 0x4e */
+	uint16_t base;		/* EC base address, LDN 4 regs 0x60/0x61 */
+	uint8_t special_cfg;	/* LDN 4 reg 0xf3 as left by the firmware */
+	uint8_t mio;		/* LDN 4 reg 0x24, MMIO decode, 0 = off */
+	bool mmio_responds;	/* MMIO window returns EC data */
+	unsigned int port_ns;	/* Virtual cost of one port access */
+	unsigned int mmio_ns;	/* Virtual cost of one MMIO access */
+};
+
+struct sim_stats {
+	uint64_t port_accesses;		/* All inb()/outb() */
+	uint64_t sio_accesses;		/* Config port accesses */
+	uint64_t ec_accesses;		/* EC address/data port accesses */
+	uint64_t ec_reads;		/* EC data port reads */
+	uint64_t ec_writes;		/* EC data port writes */
+	uint64_t mmio_accesses;
+	uint64_t bank_switches;		/* Bank register writes changing bank */
+	uint64_t special_cfg_writes;	/* SMBus special config writes */
+	uint64_t smbus_violations;	/* EC accesses with SMBus enabled */
+	uint64_t sio_violations;	/* Config accesses outside config mode */
+	uint64_t region_conflicts;	/* Overlapping region requests */
+	uint64_t lock_errors;		/* Recursive locks, unbalanced unlocks */
+	uint64_t warnings;		/* WARN_ON() and friends */
+};
+
+extern struct sim_config sim_config;
+extern struct sim_stats sim_stats;
+extern uint8_t sim_ec[SIM_NUM_BANKS][256];
+extern uint8_t sim_sio_global[0x30];
+extern uint8_t sim_sio_ldn[SIM_NUM_LDNS][256];
+extern unsigned int sim_bank;
+extern uint64_t sim_now_ns;
+extern int sim_locks_held;
+extern int sim_regions_held;
+
+/* Reset the chip to its power on state for @cfg, NULL for the defaults */
+void sim_reset(const struct sim_config *cfg);
+void sim_clear_stats(void);
+
+/* Firmware side accesses, e.g. the BIOS switching banks behind our back */
+bool sim_smbus_enabled(void);
+void sim_firmware_set_bank(unsigned int bank);
+
+/* Port and MMIO accessors wired to inb()/outb()/readb()/writeb() */
+uint8_t sim_inb(unsigned int port);
+void sim_outb(uint8_t val, unsigned int port);
+uint8_t sim_readb(const volatile void *addr);
+void sim_writeb(uint8_t val, volatile void *addr);
+extern uint8_t sim_mmio_window[SIM_MMIO_SIZE];
+
+/* Virtual time and delayed work */
+unsigned long sim_jiffies(void);
+void sim_advance_ms(unsigned int ms);
+int sim_run_work(void);
+
+/* Driver lifecycle, see sim_kernel.c */
+int sim_module_init(void);
+void sim_module_exit(void);
+
+/* The registered hwmon device, as the hwmon core would drive it */
+struct device *sim_hwmon_dev(int index);
+int sim_hwmon_read(int index, int type, unsigned int attr, int channel,
+		   long *val);
+int sim_hwmon_write(int index, int type, unsigned int attr, int channel,
+		    long val);
+int sim_attr_show(int index, const char *name, char *buf);
+int sim_attr_store(int index, const char *name, const char *buf);
+int sim_bin_attr_read(int index, const char *name, void *buf, long off,
+		      unsigned long count);
+int sim_cooling_count(void);
+int sim_cooling_get(int i, const char **type, unsigned long *max,
+		    unsigned long *cur);
+int sim_cooling_set(int i, unsigned long state);
+void sim_kernel_reset(void);
+int sim_mmio_mappings(void);
+
+#endif /* SIM_H */
@@ -0,0 +1,734 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Userspace stand-ins for the kernel services used by asustor_it87.c:
+ * devres, the platform bus, the hwmon core, delayed work and I/O regions.
+ */
+#include "include/sim_kernel.h"
+
+#define SIM_MAX_DEVICES		2
+#define SIM_MAX_REGIONS		16
+#define SIM_MAX_WORK		16
+#define SIM_MAX_COOLING		8
+
+int sim_verbose;
+int sim_locks_held;
+int sim_regions_held;
+
+static struct platform_driver *sim_driver;
+
+static struct {
+	struct device dev;
+	const struct hwmon_chip_info *info;
+	const struct attribute_group **groups;
+} sim_hwmon[SIM_MAX_DEVICES];
+static int sim_nr_hwmon;
+
+static struct thermal_cooling_device sim_cooling[SIM_MAX_COOLING];
+static int sim_nr_cooling;
+
+static struct {
+	resource_size_t start, n;
+	bool muxed;
+} sim_region[SIM_MAX_REGIONS];
+
+static struct delayed_work *sim_work[SIM_MAX_WORK];
+
+void sim_warn(const char *file, int line, const char *cond)
+{
+	sim_stats.warnings++;
+	fprintf(stderr, "WARNING: %s:%d: %s\n", file, line, cond);
+}
+
+/* Strings */
+
+static int sim_kstrto(const char *s, unsigned int base, bool sign, long *res)
+{
+	char *end;
+
+	if (!*s || (!sign && *s == '-'))
+		return -EINVAL;
+	errno = 0;
+	*res = sign ? strtol(s, &end, base) : (long)strtoul(s, &end, base);
+	if (errno)
+		return -ERANGE;
+	if (end == s)
+		return -EINVAL;
+	if (*end == '\n')
+		end++;
+	return *end ? -EINVAL : 0;
+}
+
+int kstrtol(const char *s, unsigned int base, long *res)
+{
+	return sim_kstrto(s, base, true, res);
+}
+
+int kstrtoul(const char *s, unsigned int base, unsigned long *res)
+{
+	return sim_kstrto(s, base, false, (long *)res);
+}
+
+void sort(void *base, size_t num, size_t size,
+	  int (*cmp)(const void *, const void *), void *swap)
+{
+	qsort(base, num, size, cmp);
+}
+
+ssize_t memory_read_from_buffer(void *to, size_t count, loff_t *ppos,
+				const void *from, size_t available)
+{
+	loff_t pos = *ppos;
+
+	if (pos < 0)
+		return -EINVAL;
+	if (pos >= available || !count)
+		return 0;
+	if (count > available - pos)
+		count = available - pos;
+	memcpy(to, (const char *)from + pos, count);
+	*ppos = pos + count;
+	return count;
+}
+
+/* Locking */
+
+void mutex_init(struct mutex *lock)
+{
+	lock->held = 0;
+}
+
+void mutex_lock(struct mutex *lock)
+{
+	if (lock->held) {
+		sim_stats.lock_errors++;
+		fprintf(stderr, "ERROR: mutex %p locked recursively\n", lock);
+	}
+	lock->held++;
+	sim_locks_held++;
+}
+
+void mutex_unlock(struct mutex *lock)
+{
+	if (!lock->held) {
+		sim_stats.lock_errors++;
+		fprintf(stderr, "ERROR: mutex %p unlocked twice\n", lock);
+		return;
+	}
+	lock->held--;
+	sim_locks_held--;
+}
+
+/* Time and delayed work */
+
+unsigned long sim_jiffies(void)
+{
+	return sim_now_ns / 1000000;
+}
+
+bool schedule_delayed_work(struct delayed_work *dwork, unsigned long delay)
+{
+	int i, slot = -1;
+
+	if (dwork->pending)
+		return false;
+	for (i = 0; i < SIM_MAX_WORK; i++) {
+		if (sim_work[i] == dwork)
+			slot = i;
+		else if (!sim_work[i] && slot < 0)
+			slot = i;
+	}
+	if (slot < 0) {
+		sim_warn(__FILE__, __LINE__, "too many delayed works");
+		return false;
+	}
+	sim_work[slot] = dwork;
+	dwork->pending = true;
+	dwork->expires = jiffies + delay;
+	return true;
+}
+
+bool cancel_delayed_work_sync(struct delayed_work *dwork)
+{
+	bool pending = dwork->pending;
+	int i;
+
+	dwork->pending = false;
+	for (i = 0; i < SIM_MAX_WORK; i++) {
+		if (sim_work[i] == dwork)
+			sim_work[i] = NULL;
+	}
+	return pending;
+}
+
+/* Run the delayed works that are due, returns how many ran */
+int sim_run_work(void)
+{
+	int i, ran = 0;
+
+	for (i = 0; i < SIM_MAX_WORK; i++) {
+		struct delayed_work *dwork = sim_work[i];
+
+		if (!dwork || !dwork->pending ||
+		    time_before(jiffies, dwork->expires))
+			continue;
+		sim_work[i] = NULL;
+		dwork->pending = false;
+		dwork->work.func(&dwork->work);
+		ran++;
+	}
+	return ran;
+}
+
+/* Advance in 1 ms steps so that periodic works run on time */
+void sim_advance_ms(unsigned int ms)
+{
+	while (ms--) {
+		sim_now_ns += 1000000;
+		sim_run_work();
+	}
+}
+
+/* I/O regions */
+
+static struct resource sim_region_res;
+
+static struct resource *sim_request_region(resource_size_t start,
+					   resource_size_t n, bool muxed)
+{
+	int i, slot = -1;
+
+	for (i = 0; i < SIM_MAX_REGIONS; i++) {
+		if (!sim_region[i].n) {
+			if (slot < 0)
+				slot = i;
+			continue;
+		}
+		if (start < sim_region[i].start + sim_region[i].n &&
+		    sim_region[i].start < start + n) {
+			/* A muxed request would sleep forever here */
+			sim_stats.region_conflicts++;
+			fprintf(stderr, "ERROR: region 0x%llx+%llu busy%s\n",
+				(unsigned long long)start,
+				(unsigned long long)n,
+				muxed ? " (deadlock)" : "");
+			return NULL;
+		}
+	}
+	if (slot < 0)
+		return NULL;
+	sim_region[slot].start = start;
+	sim_region[slot].n = n;
+	sim_region[slot].muxed = muxed;
+	sim_regions_held++;
+	return &sim_region_res;
+}
+
+struct resource *request_muxed_region(resource_size_t start,
+				      resource_size_t n, const char *name)
+{
+	return sim_request_region(start, n, true);
+}
+
+struct resource *request_region(resource_size_t start, resource_size_t n,
+				const char *name)
+{
+	return sim_request_region(start, n, false);
+}
+
+void release_region(resource_size_t start, resource_size_t n)
+{
+	int i;
+
+	for (i = 0; i < SIM_MAX_REGIONS; i++) {
+		if (sim_region[i].n && sim_region[i].start == start) {
+			sim_region[i].n = 0;
+			sim_regions_held--;
+			return;
+		}
+	}
+	sim_warn(__FILE__, __LINE__, "release of a region never requested");
+}
+
+/* devres, released in reverse order of registration */
+
+int devm_add_action_or_reset(struct device *dev, void (*action)(void *),
+			     void *data)
+{
+	struct devres *dr = calloc(1, sizeof(*dr));
+
+	if (!dr) {
+		action(data);
+		return -ENOMEM;
+	}
+	dr->action = action;
+	dr->data = data;
+	dr->next = dev->devres;
+	dev->devres = dr;
+	return 0;
+}
+
+void devres_release_all(struct device *dev)
+{
+	while (dev->devres) {
+		struct devres *dr = dev->devres;
+
+		dev->devres = dr->next;
+		dr->action(dr->data);
+		free(dr);
+	}
+}
+
+/* Run and forget the first devres matching @action, and @match if given */
+static bool sim_devres_release(struct device *dev, void (*action)(void *),
+			       bool (*match)(void *, void *), void *arg)
+{
+	struct devres **pp, *dr;
+
+	for (pp = &dev->devres; (dr = *pp); pp = &dr->next) {
+		if (dr->action != action || (match && !match(dr->data, arg)))
+			continue;
+		*pp = dr->next;
+		dr->action(dr->data);
+		free(dr);
+		return true;
+	}
+	return false;
+}
+
+void *devm_kzalloc(struct device *dev, size_t size, gfp_t gfp)
+{
+	void *p = calloc(1, size);
+
+	if (p && devm_add_action_or_reset(dev, free, p))
+		return NULL;
+	return p;
+}
+
+void *devm_kcalloc(struct device *dev, size_t n, size_t size, gfp_t gfp)
+{
+	return devm_kzalloc(dev, n * size, gfp);
+}
+
+char *devm_kasprintf(struct device *dev, gfp_t gfp, const char *fmt, ...)
+{
+	va_list ap;
+	char *p;
+
+	va_start(ap, fmt);
+	if (vasprintf(&p, fmt, ap) < 0)
+		p = NULL;
+	va_end(ap);
+	if (p && devm_add_action_or_reset(dev, free, p))
+		return NULL;
+	return p;
+}
+
+static void sim_devm_release_region(void *res)
+{
+	const struct resource *r = res;
+
+	release_region(r->start, resource_size(r));
+	free(res);
+}
+
+struct resource *devm_request_region(struct device *dev,
+				     resource_size_t start,
+				     resource_size_t n, const char *name)
+{
+	struct resource *r;
+
+	if (!sim_request_region(start, n, false))
+		return NULL;
+	r = calloc(1, sizeof(*r));
+	if (!r) {
+		release_region(start, n);
+		return NULL;
+	}
+	r->start = start;
+	r->end = start + n - 1;
+	if (devm_add_action_or_reset(dev, sim_devm_release_region, r))
+		return NULL;
+	return r;
+}
+
+static int sim_mappings;
+
+static void sim_iounmap(void *addr)
+{
+	sim_mappings--;
+}
+
+/* Claims the region and maps the simulated window, as two devres */
+void __iomem *devm_ioremap_resource(struct device *dev,
+				    const struct resource *res)
+{
+	if (!devm_request_region(dev, res->start, resource_size(res), NULL))
+		return ERR_PTR(-EBUSY);
+	sim_mappings++;
+	if (devm_add_action_or_reset(dev, sim_iounmap, sim_mmio_window))
+		return ERR_PTR(-ENOMEM);
+	return sim_mmio_window;
+}
+
+static bool sim_match_ptr(void *data, void *arg)
+{
+	return data == arg;
+}
+
+void devm_iounmap(struct device *dev, void __iomem *addr)
+{
+	if (!sim_devres_release(dev, sim_iounmap, sim_match_ptr, addr))
+		sim_warn(__FILE__, __LINE__, "devm_iounmap of unknown mapping");
+}
+
+static bool sim_match_region(void *data, void *arg)
+{
+	return ((struct resource *)data)->start == *(resource_size_t *)arg;
+}
+
+void devm_release_mem_region(struct device *dev, resource_size_t start,
+			     resource_size_t n)
+{
+	if (!sim_devres_release(dev, sim_devm_release_region,
+				sim_match_region, &start))
+		sim_warn(__FILE__, __LINE__, "release of unknown region");
+}
+
+int sim_mmio_mappings(void)
+{
+	return sim_mappings;
+}
+
+/* Platform bus */
+
+struct resource *platform_get_resource(struct platform_device *pdev,
+				       unsigned int type, unsigned int num)
+{
+	unsigned int i;
+
+	for (i = 0; i < pdev->num_resources; i++) {
+		if ((pdev->resource[i].flags & type) && !num--)
+			return &pdev->resource[i];
+	}
+	return NULL;
+}
+
+struct platform_device *platform_device_alloc(const char *name, int id)
+{
+	struct platform_device *pdev = calloc(1, sizeof(*pdev));
+
+	if (pdev) {
+		pdev->name = name;
+		pdev->id = id;
+		pdev->dev.kobj.name = name;
+	}
+	return pdev;
+}
+
+int platform_device_add_resources(struct platform_device *pdev,
+				  const struct resource *res,
+				  unsigned int num)
+{
+	pdev->resource = calloc(num, sizeof(*res));
+	if (!pdev->resource)
+		return -ENOMEM;
+	memcpy(pdev->resource, res, num * sizeof(*res));
+	pdev->num_resources = num;
+	return 0;
+}
+
+int platform_device_add_data(struct platform_device *pdev, const void *data,
+			     size_t size)
+{
+	pdev->dev.platform_data = malloc(size);
+	if (!pdev->dev.platform_data)
+		return -ENOMEM;
+	memcpy(pdev->dev.platform_data, data, size);
+	return 0;
+}
+
+/* Binding failures are not fatal for the device, as in the kernel */
+int platform_device_add(struct platform_device *pdev)
+{
+	int err;
+
+	if (!sim_driver)
+		return 0;
+	err = sim_driver->probe(pdev);
+	if (err) {
+		fprintf(stderr, "probe of %s failed with error %d\n",
+			pdev->name, err);
+		devres_release_all(&pdev->dev);
+		pdev->dev.driver_data = NULL;
+	}
+	return 0;
+}
+
+void platform_device_put(struct platform_device *pdev)
+{
+	if (!pdev)
+		return;
+	free(pdev->resource);
+	free(pdev->dev.platform_data);
+	free(pdev);
+}
+
+void platform_device_unregister(struct platform_device *pdev)
+{
+	int i;
+
+	if (!pdev)
+		return;
+	for (i = 0; i < sim_nr_hwmon; i++) {
+		if (sim_hwmon[i].dev.parent == &pdev->dev)
+			sim_hwmon[i].dev.parent = NULL;
+	}
+	devres_release_all(&pdev->dev);
+	platform_device_put(pdev);
+}
+
+int platform_driver_register(struct platform_driver *drv)
+{
+	sim_driver = drv;
+	return 0;
+}
+
+void platform_driver_unregister(struct platform_driver *drv)
+{
+	sim_driver = NULL;
+}
+
+/* hwmon core */
+
+static void sim_hwmon_release(void *p)
+{
+	int i = (long)p;
+
+	memset(&sim_hwmon[i], 0, sizeof(sim_hwmon[i]));
+	if (i == sim_nr_hwmon - 1)
+		sim_nr_hwmon--;
+}
+
+struct device *devm_hwmon_device_register_with_info(struct device *dev,
+		const char *name, void *drvdata,
+		const struct hwmon_chip_info *info,
+		const struct attribute_group **extra_groups)
+{
+	int i = sim_nr_hwmon;
+
+	if (i >= SIM_MAX_DEVICES)
+		return ERR_PTR(-ENOMEM);
+	sim_hwmon[i].dev.kobj.name = name;
+	sim_hwmon[i].dev.parent = dev;
+	sim_hwmon[i].dev.driver_data = drvdata;
+	sim_hwmon[i].info = info;
+	sim_hwmon[i].groups = extra_groups;
+	sim_nr_hwmon++;
+	if (devm_add_action_or_reset(dev, sim_hwmon_release, (void *)(long)i))
+		return ERR_PTR(-ENOMEM);
+	return &sim_hwmon[i].dev;
+}
+
+struct device *sim_hwmon_dev(int index)
+{
+	if (index >= sim_nr_hwmon || !sim_hwmon[index].info)
+		return NULL;
+	return &sim_hwmon[index].dev;
+}
+
+static int sim_hwmon_check(int index, int type, unsigned int attr,
+			   int channel, umode_t mode)
+{
+	const struct hwmon_chip_info *info;
+	struct device *dev = sim_hwmon_dev(index);
+	umode_t visible;
+
+	if (!dev)
+		return -ENODEV;
+	info = sim_hwmon[index].info;
+	visible = info->ops->is_visible(dev->driver_data, type, attr, channel);
+	return (visible & mode) ? 0 : -EACCES;
+}
+
+int sim_hwmon_read(int index, int type, unsigned int attr, int channel,
+		   long *val)
+{
+	int err = sim_hwmon_check(index, type, attr, channel, 0444);
+
+	if (err)
+		return err;
+	return sim_hwmon[index].info->ops->read(&sim_hwmon[index].dev, type,
+						attr, channel, val);
+}
+
+int sim_hwmon_write(int index, int type, unsigned int attr, int channel,
+		    long val)
+{
+	int err = sim_hwmon_check(index, type, attr, channel, 0222);
+
+	if (err)
+		return err;
+	return sim_hwmon[index].info->ops->write(&sim_hwmon[index].dev, type,
+						 attr, channel, val);
+}
+
+/* Find a visible attribute of the extra groups by name */
+static struct attribute *sim_find_attr(int index, const char *name,
+				       bool bin, umode_t *mode)
+{
+	const struct attribute_group **groups;
+	struct device *dev = sim_hwmon_dev(index);
+	int g, i;
+
+	if (!dev)
+		return NULL;
+	groups = sim_hwmon[index].groups;
+	for (g = 0; groups && groups[g]; g++) {
+		const struct attribute_group *grp = groups[g];
+
+		if (bin) {
+			for (i = 0; grp->bin_attrs && grp->bin_attrs[i]; i++) {
+				struct attribute *a = &grp->bin_attrs[i]->attr;
+
+				if (!strcmp(a->name, name)) {
+					*mode = a->mode;
+					return a;
+				}
+			}
+			continue;
+		}
+		for (i = 0; grp->attrs && grp->attrs[i]; i++) {
+			struct attribute *a = grp->attrs[i];
+
+			if (strcmp(a->name, name))
+				continue;
+			*mode = grp->is_visible ?
+				grp->is_visible(&dev->kobj, a, i) : a->mode;
+			if (!*mode)
+				return NULL;
+			return a;
+		}
+	}
+	return NULL;
+}
+
+int sim_attr_show(int index, const char *name, char *buf)
+{
+	struct device_attribute *da;
+	struct attribute *a;
+	umode_t mode;
+
+	a = sim_find_attr(index, name, false, &mode);
+	if (!a || !(mode & 0444))
+		return -ENOENT;
+	da = container_of(a, struct device_attribute, attr);
+	return da->show(&sim_hwmon[index].dev, da, buf);
+}
+
+int sim_attr_store(int index, const char *name, const char *buf)
+{
+	struct device_attribute *da;
+	struct attribute *a;
+	umode_t mode;
+
+	a = sim_find_attr(index, name, false, &mode);
+	if (!a || !(mode & 0222))
+		return -ENOENT;
+	da = container_of(a, struct device_attribute, attr);
+	return da->store(&sim_hwmon[index].dev, da, buf, strlen(buf));
+}
+
+int sim_bin_attr_read(int index, const char *name, void *buf, long off,
+		      unsigned long count)
+{
+	struct bin_attribute *ba;
+	struct attribute *a;
+	umode_t mode;
+
+	a = sim_find_attr(index, name, true, &mode);
+	if (!a)
+		return -ENOENT;
+	ba = container_of(a, struct bin_attribute, attr);
+	return ba->read(NULL, &sim_hwmon[index].dev.kobj, ba, buf, off, count);
+}
+
+/* Thermal cooling devices */
+
+static void sim_cooling_release(void *p)
+{
+	struct thermal_cooling_device *cdev = p;
+
+	cdev->ops = NULL;
+}
+
+struct thermal_cooling_device *
+devm_thermal_of_cooling_device_register(struct device *dev,
+					struct device_node *np,
+					const char *type, void *devdata,
+					const struct thermal_cooling_device_ops *ops)
+{
+	struct thermal_cooling_device *cdev;
+
+	if (sim_nr_cooling >= SIM_MAX_COOLING)
+		return ERR_PTR(-ENOMEM);
+	cdev = &sim_cooling[sim_nr_cooling++];
+	cdev->type = type;
+	cdev->devdata = devdata;
+	cdev->ops = ops;
+	if (devm_add_action_or_reset(dev, sim_cooling_release, cdev))
+		return ERR_PTR(-ENOMEM);
+	return cdev;
+}
+
+int sim_cooling_count(void)
+{
+	int i, n = 0;
+
+	for (i = 0; i < sim_nr_cooling; i++)
+		n += !!sim_cooling[i].ops;
+	return n;
+}
+
+static struct thermal_cooling_device *sim_cooling_nth(int n)
+{
+	int i;
+
+	for (i = 0; i < sim_nr_cooling; i++) {
+		if (sim_cooling[i].ops && !n--)
+			return &sim_cooling[i];
+	}
+	return NULL;
+}
+
+int sim_cooling_get(int i, const char **type, unsigned long *max,
+		    unsigned long *cur)
+{
+	struct thermal_cooling_device *cdev = sim_cooling_nth(i);
+	int err;
+
+	if (!cdev)
+		return -ENODEV;
+	*type = cdev->type;
+	err = cdev->ops->get_max_state(cdev, max);
+	return err ? err : cdev->ops->get_cur_state(cdev, cur);
+}
+
+int sim_cooling_set(int i, unsigned long state)
+{
+	struct thermal_cooling_device *cdev = sim_cooling_nth(i);
+
+	if (!cdev)
+		return -ENODEV;
+	return cdev->ops->set_cur_state(cdev, state);
+}
+
+/* Forget the bookkeeping of a previous load */
+void sim_kernel_reset(void)
+{
+	memset(sim_hwmon, 0, sizeof(sim_hwmon));
+	sim_nr_hwmon = 0;
+	memset(sim_cooling, 0, sizeof(sim_cooling));
+	sim_nr_cooling = 0;
+	memset(sim_work, 0, sizeof(sim_work));
+	sim_locks_held = 0;
+}